@@ -15,6 +15,15 @@
 #include <string>
 #include <sstream>
 #include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/wait.h>
+#endif
 
 #include "llvm/Support/raw_ostream.h"
 #include "TransformationManager.h"
@@ -58,9 +67,11 @@ static void PrintHelpMessage()
   llvm::outs() << "  --transformations: ";
   llvm::outs() << "print the names of all available transformations\n";
 
-  llvm::outs() << "  --query-instances=<name>: ";
+  llvm::outs() << "  --query-instances=<name>[,<name>...]: ";
   llvm::outs() << "query available transformation instances for a given ";
-  llvm::outs() << "transformation\n";
+  llvm::outs() << "transformation (when several comma-separated names are ";
+  llvm::outs() << "given, the source is parsed once and one line is printed ";
+  llvm::outs() << "per transformation)\n";
 
   llvm::outs() << "  --counter=<number>: ";
   llvm::outs() << "specify the instance of the transformation to perform\n";
@@ -84,9 +95,32 @@ static void PrintHelpMessage()
   llvm::outs() << "this option works only with transformation ";
   llvm::outs() << "expression-detector.\n";
 
+  llvm::outs() << "  --coverage=<filename>: ";
+  llvm::outs() << "read which lines of the source ran from this file, ";
+  llvm::outs() << "in the text format of gcov. Currently, this option ";
+  llvm::outs() << "works only with transformation remove-unexecuted-code.\n";
+
+  llvm::outs() << "  --max-errors=<number>: ";
+  llvm::outs() << "give up (exit code 2) once more than this many ";
+  llvm::outs() << "declarations of the source have errors in them; this ";
+  llvm::outs() << "also turns off typo correction\n";
+
+  llvm::outs() << "  --max-instantiation-depth=<number>: ";
+  llvm::outs() << "limit the depth of recursive template instantiation\n";
+
+  llvm::outs() << "  --time-limit=<seconds>: ";
+  llvm::outs() << "give up (exit code 2) after this many seconds\n";
+
   llvm::outs() << "  --output=<filename>: ";
   llvm::outs() << "specify where to output the transformed source code ";
   llvm::outs() << "(default: stdout)\n";
+
+  llvm::outs() << "  --server: ";
+  llvm::outs() << "read one run per line of standard input, as an id, ";
+  llvm::outs() << "the file that the run's standard output goes to and ";
+  llvm::outs() << "the run's options, separated by tabs; each run is a ";
+  llvm::outs() << "process forked from this one, and \"<id> <exit code>\" ";
+  llvm::outs() << "is printed once it is done (must be the only option)\n";
   llvm::outs() << "\n";
 }
 
@@ -123,8 +157,12 @@ static void HandleOneArgValue(const std::string &ArgValueStr, size_t SepPos)
     }
   }
   else if (!ArgName.compare("query-instances")) {
-    if (TransMgr->setTransformation(ArgValue)) {
-      Die("Invalid transformation[" + ArgValue + "]");
+    std::stringstream TmpSS(ArgValue);
+    std::string Name;
+    while (std::getline(TmpSS, Name, ',')) {
+      if (TransMgr->addQueryTransformation(Name)) {
+        Die("Invalid transformation[" + Name + "]");
+      }
     }
     TransMgr->setQueryInstanceFlag(true);
     TransMgr->setTransformationCounter(1);
@@ -151,6 +189,23 @@ static void HandleOneArgValue(const std::string &ArgValueStr, size_t SepPos)
 
     TransMgr->setToCounter(Val);
   }
+  else if (!ArgName.compare("max-errors") ||
+           !ArgName.compare("max-instantiation-depth") ||
+           !ArgName.compare("time-limit")) {
+    int Val;
+    std::stringstream TmpSS(ArgValue);
+
+    if (!(TmpSS >> Val) || (Val < 0)) {
+      Die("Invalid " + ArgName + "[" + ArgValueStr + "]");
+    }
+
+    if (!ArgName.compare("max-errors"))
+      TransMgr->setMaxErrors(Val);
+    else if (!ArgName.compare("max-instantiation-depth"))
+      TransMgr->setMaxInstantiationDepth(Val);
+    else
+      TransMgr->setTimeLimit(Val);
+  }
   else if (!ArgName.compare("output")) {
     TransMgr->setOutputFileName(ArgValue);
   }
@@ -160,6 +215,9 @@ static void HandleOneArgValue(const std::string &ArgValueStr, size_t SepPos)
   else if (!ArgName.compare("check-reference")) {
     TransMgr->setReferenceValue(ArgValue);
   }
+  else if (!ArgName.compare("coverage")) {
+    TransMgr->setCoverageFileName(ArgValue);
+  }
   else {
     DieOnBadCmdArg("--" + ArgValueStr);
   }
@@ -211,13 +269,8 @@ static void HandleOneArg(const char *Arg)
   }
 }
 
-int main(int argc, char **argv)
+static void Run()
 {
-  TransMgr = TransformationManager::GetInstance();
-  for (int i = 1; i < argc; i++) {
-    HandleOneArg(argv[i]);
-  }
-
   std::string ErrorMsg;
   if (!TransMgr->verify(ErrorMsg, ErrorCode))
     Die(ErrorMsg);
@@ -234,6 +287,71 @@ int main(int argc, char **argv)
     TransMgr->outputNumTransformationInstances();
 
   TransformationManager::Finalize();
+}
+
+#ifndef _WIN32
+// Each run only pays for the fork, not for loading clang_delta and
+// registering all of the transformations again.  A run that crashes
+// is reported like a crashed process would be by a shell, as 128 plus
+// the signal number.
+static int RunServer()
+{
+  std::string Line;
+  while (std::getline(std::cin, Line)) {
+    std::vector<std::string> Args;
+    std::stringstream TmpSS(Line);
+    std::string Arg;
+    while (std::getline(TmpSS, Arg, '\t'))
+      Args.push_back(Arg);
+    if (Args.size() < 2) {
+      llvm::outs() << "Error: Bad server request `" << Line << "`\n";
+      llvm::outs().flush();
+      continue;
+    }
+
+    llvm::outs().flush();
+    pid_t Pid = fork();
+    if (Pid == 0) {
+      int Fd = open(Args[1].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (Fd < 0)
+        _exit(255);
+      dup2(Fd, STDOUT_FILENO);
+      close(Fd);
+      for (size_t I = 2; I < Args.size(); ++I)
+        HandleOneArg(Args[I].c_str());
+      Run();
+      llvm::outs().flush();
+      exit(0);
+    }
+
+    int Code = 255;
+    int Status;
+    if (Pid > 0 && waitpid(Pid, &Status, 0) == Pid) {
+      if (WIFEXITED(Status))
+        Code = WEXITSTATUS(Status);
+      else if (WIFSIGNALED(Status))
+        Code = 128 + WTERMSIG(Status);
+    }
+    llvm::outs() << Args[0] << " " << Code << "\n";
+    llvm::outs().flush();
+  }
+  TransformationManager::Finalize();
+  return 0;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+  TransMgr = TransformationManager::GetInstance();
+#ifndef _WIN32
+  if ((argc == 2) && !strcmp(argv[1], "--server"))
+    return RunServer();
+#endif
+  for (int i = 1; i < argc; i++) {
+    HandleOneArg(argv[i]);
+  }
+
+  Run();
   return 0;
 }
 
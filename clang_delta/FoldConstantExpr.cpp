@@ -0,0 +1,277 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "FoldConstantExpr.h"
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/SmallString.h"
+
+#include "TransformationManager.h"
+
+using namespace clang;
+
+static const char *DescriptionMsg =
+"Replace an integer or floating-point constant expression, \
+such as sizeof, enumerator arithmetic, a cast of a literal \
+or a macro that expands to one of these, with the literal \
+it evaluates to. Only expressions whose literal is shorter \
+are replaced; instances never overlap, and --to-counter \
+replaces a whole range of them at once. \n";
+
+static RegisterTransformation<FoldConstantExpr>
+         Trans("fold-constant-expr", DescriptionMsg);
+
+class FoldConstantExprVisitor : public
+  RecursiveASTVisitor<FoldConstantExprVisitor> {
+public:
+
+  explicit FoldConstantExprVisitor(FoldConstantExpr *Instance)
+    : ConsumerInstance(Instance)
+  { }
+
+  bool VisitExpr(Expr *E);
+
+private:
+
+  FoldConstantExpr *ConsumerInstance;
+};
+
+// Parents are visited before their children, so the outermost foldable
+// expression is found first and hides the ones inside it.
+bool FoldConstantExprVisitor::VisitExpr(Expr *E)
+{
+  if (ConsumerInstance->isInIncludedFile(E))
+    return true;
+  ConsumerInstance->handleOneExpr(E);
+  return true;
+}
+
+void FoldConstantExpr::Initialize(ASTContext &context)
+{
+  Transformation::Initialize(context);
+  CollectionVisitor = new FoldConstantExprVisitor(this);
+}
+
+void FoldConstantExpr::HandleTranslationUnit(ASTContext &Ctx)
+{
+  CollectionVisitor->TraverseDecl(Ctx.getTranslationUnitDecl());
+
+  if (QueryInstanceOnly)
+    return;
+
+  if (TransformationCounter > ValidInstanceNum) {
+    TransError = TransMaxInstanceError;
+    return;
+  }
+  if (ToCounter > ValidInstanceNum) {
+    TransError = TransToCounterTooBigError;
+    return;
+  }
+
+  Ctx.getDiagnostics().setSuppressAllDiagnostics(false);
+
+  int Last = (ToCounter > 0) ? ToCounter : TransformationCounter;
+  for (int I = TransformationCounter; I <= Last; ++I) {
+    const FoldedExpr &F = AllFoldedExprs[I-1];
+    TheRewriter.ReplaceText(F.first, F.second);
+  }
+
+  if (Ctx.getDiagnostics().hasErrorOccurred() ||
+      Ctx.getDiagnostics().hasFatalErrorOccurred())
+    TransError = TransInternalError;
+}
+
+// The file range of E, provided that E is not only part of what a macro
+// expands to, which could not be rewritten without changing the macro.
+// An E that makes up a whole macro invocation, even through the macro's
+// arguments as with ID(3 + 4), is the range of that invocation.
+bool FoldConstantExpr::getFileRange(const Expr *E, SourceRange &Range)
+{
+  SourceLocation StartLoc = E->getBeginLoc();
+  SourceLocation EndLoc = E->getEndLoc();
+  if (StartLoc.isInvalid() || EndLoc.isInvalid())
+    return false;
+
+  const LangOptions &LangOpts = Context->getLangOpts();
+  if (StartLoc.isMacroID()) {
+    SourceLocation ExpansionLoc;
+    if (!Lexer::isAtStartOfMacroExpansion(StartLoc, *SrcManager,
+                                          LangOpts, &ExpansionLoc))
+      return false;
+    StartLoc = ExpansionLoc;
+  }
+  if (EndLoc.isMacroID()) {
+    SourceLocation ExpansionLoc;
+    if (!Lexer::isAtEndOfMacroExpansion(EndLoc, *SrcManager,
+                                        LangOpts, &ExpansionLoc))
+      return false;
+    EndLoc = ExpansionLoc;
+  }
+  if (StartLoc.isMacroID() || EndLoc.isMacroID())
+    return false;
+  if (SrcManager->getFileID(StartLoc) != SrcManager->getFileID(EndLoc))
+    return false;
+
+  Range = SourceRange(StartLoc, EndLoc);
+  return true;
+}
+
+bool FoldConstantExpr::getIntLiteral(const llvm::APSInt &Val, QualType QT,
+                                     std::string &Str)
+{
+  const Type *Ty = QT.getCanonicalType().getTypePtr();
+  if (Ty->isBooleanType()) {
+    if (Context->getLangOpts().CPlusPlus)
+      Str = Val.getBoolValue() ? "true" : "false";
+    else
+      Str = Val.getBoolValue() ? "1" : "0";
+    return true;
+  }
+
+  // there is no literal for the most negative value of a type
+  if (Val.isSigned() && Val.isMinSignedValue())
+    return false;
+
+  std::string Suffix;
+  if (const BuiltinType *BT = dyn_cast<BuiltinType>(Ty)) {
+    switch (BT->getKind()) {
+    case BuiltinType::UInt:
+      Suffix = "U";
+      break;
+    case BuiltinType::Long:
+      Suffix = "L";
+      break;
+    case BuiltinType::ULong:
+      Suffix = "UL";
+      break;
+    case BuiltinType::LongLong:
+      Suffix = "LL";
+      break;
+    case BuiltinType::ULongLong:
+      Suffix = "ULL";
+      break;
+    case BuiltinType::Int128:
+    case BuiltinType::UInt128:
+      return false;
+    default:
+      break;
+    }
+  }
+
+  Str = Val.toString(10) + Suffix;
+  if (Val.isNegative())
+    Str = "(" + Str + ")";
+  return true;
+}
+
+bool FoldConstantExpr::getFloatLiteral(const llvm::APFloat &Val, QualType QT,
+                                       std::string &Str)
+{
+  if (!Val.isFinite())
+    return false;
+
+  std::string Suffix;
+  const BuiltinType *BT =
+    dyn_cast<BuiltinType>(QT.getCanonicalType().getTypePtr());
+  if (!BT)
+    return false;
+  switch (BT->getKind()) {
+  case BuiltinType::Float:
+    Suffix = "f";
+    break;
+  case BuiltinType::Double:
+    break;
+  case BuiltinType::LongDouble:
+    Suffix = "L";
+    break;
+  default:
+    return false;
+  }
+
+  // the default precision is enough to read back the same value
+  llvm::SmallString<32> Buf;
+  Val.toString(Buf);
+  Str.assign(Buf.begin(), Buf.end());
+  if (Str.find_first_of(".E") == std::string::npos)
+    Str += ".0";
+  Str += Suffix;
+  if (Val.isNegative())
+    Str = "(" + Str + ")";
+  return true;
+}
+
+bool FoldConstantExpr::getFoldedLiteral(const Expr *E, std::string &Str)
+{
+  QualType QT = E->getType();
+  if (QT.isNull())
+    return false;
+
+  if (QT->isIntegralOrEnumerationType()) {
+    // an int is no substitute for an enumerator in C++
+    if (QT->isEnumeralType() && Context->getLangOpts().CPlusPlus)
+      return false;
+    Expr::EvalResult Result;
+    if (!E->EvaluateAsInt(Result, *Context) || Result.HasSideEffects)
+      return false;
+    return getIntLiteral(Result.Val.getInt(), QT, Str);
+  }
+
+  if (QT->isRealFloatingType()) {
+    Expr::EvalResult Result;
+    if (!E->EvaluateAsRValue(Result, *Context) || Result.HasSideEffects ||
+        !Result.Val.isFloat())
+      return false;
+    return getFloatLiteral(Result.Val.getFloat(), QT, Str);
+  }
+
+  return false;
+}
+
+void FoldConstantExpr::handleOneExpr(const Expr *E)
+{
+  // implicit nodes have the same extent as what they wrap; literals
+  // are already as folded as they get
+  if (isa<ImplicitCastExpr>(E) || isa<ConstantExpr>(E) ||
+      isa<IntegerLiteral>(E) || isa<FloatingLiteral>(E) ||
+      isa<CharacterLiteral>(E) || isa<CXXBoolLiteralExpr>(E))
+    return;
+  if (E->isValueDependent() || E->isTypeDependent() || E->isGLValue())
+    return;
+
+  SourceRange Range;
+  if (!getFileRange(E, Range))
+    return;
+  if (LastEnd.isValid() &&
+      !SrcManager->isBeforeInTranslationUnit(LastEnd, Range.getBegin()))
+    return;
+
+  std::string Str;
+  if (!getFoldedLiteral(E, Str))
+    return;
+  int RangeSize = TheRewriter.getRangeSize(Range);
+  if (RangeSize == -1 || static_cast<int>(Str.size()) >= RangeSize)
+    return;
+
+  LastEnd = Range.getEnd();
+  ValidInstanceNum++;
+  AllFoldedExprs.push_back(FoldedExpr(Range, Str));
+}
+
+FoldConstantExpr::~FoldConstantExpr(void)
+{
+  delete CollectionVisitor;
+}
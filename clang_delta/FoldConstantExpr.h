@@ -0,0 +1,80 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef FOLD_CONSTANT_EXPR_H
+#define FOLD_CONSTANT_EXPR_H
+
+#include <string>
+#include <utility>
+#include "llvm/ADT/SmallVector.h"
+#include "clang/Basic/SourceLocation.h"
+#include "Transformation.h"
+
+namespace clang {
+  class ASTContext;
+  class Expr;
+  class QualType;
+}
+
+namespace llvm {
+  class APFloat;
+  class APSInt;
+}
+
+class FoldConstantExprVisitor;
+
+class FoldConstantExpr : public Transformation {
+friend class FoldConstantExprVisitor;
+
+public:
+
+  FoldConstantExpr(const char *TransName, const char *Desc)
+    : Transformation(TransName, Desc, /*MultipleRewrites*/true),
+      CollectionVisitor(NULL)
+  { }
+
+  ~FoldConstantExpr(void);
+
+private:
+
+  typedef std::pair<clang::SourceRange, std::string> FoldedExpr;
+
+  virtual void Initialize(clang::ASTContext &context);
+
+  virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
+
+  bool getFileRange(const clang::Expr *E, clang::SourceRange &Range);
+
+  bool getIntLiteral(const llvm::APSInt &Val, clang::QualType QT,
+                     std::string &Str);
+
+  bool getFloatLiteral(const llvm::APFloat &Val, clang::QualType QT,
+                       std::string &Str);
+
+  bool getFoldedLiteral(const clang::Expr *E, std::string &Str);
+
+  void handleOneExpr(const clang::Expr *E);
+
+  FoldConstantExprVisitor *CollectionVisitor;
+
+  // every instance, in source order, with the literal that replaces it
+  llvm::SmallVector<FoldedExpr, 20> AllFoldedExprs;
+
+  // end of the last instance, which no later one may overlap
+  clang::SourceLocation LastEnd;
+
+  // Unimplemented
+  FoldConstantExpr(void);
+
+  FoldConstantExpr(const FoldConstantExpr &);
+
+  void operator=(const FoldConstantExpr &);
+};
+#endif
@@ -0,0 +1,255 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "MergeTemplateInstantiations.h"
+
+#include <algorithm>
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/Basic/SourceManager.h"
+
+#include "TransformationManager.h"
+
+using namespace clang;
+
+static const char *DescriptionMsg =
+"Make all of the written specializations of a class template the \
+same, so that it is instantiated only once. For a template used as \
+e.g. S<int>, S<long> and S<char *> in the main file, the template \
+arguments of all of them are replaced by those of the specialization \
+that is written most often. Each instance is one class template; \
+instances are ranked by the estimated cost of the instantiations \
+that go away, counting the members and the statements of the \
+instantiated member functions, so the most costly come first and \
+--to-counter merges a whole range of them at once. Templates with \
+explicit or partial specializations are left alone. \n";
+
+static RegisterTransformation<MergeTemplateInstantiations>
+         Trans("merge-template-instantiations", DescriptionMsg);
+
+class MergeTemplateInstantiationsVisitor : public
+  RecursiveASTVisitor<MergeTemplateInstantiationsVisitor> {
+public:
+
+  explicit MergeTemplateInstantiationsVisitor(
+             MergeTemplateInstantiations *Instance)
+    : ConsumerInstance(Instance), NestingLevel(0)
+  { }
+
+  bool TraverseTemplateSpecializationTypeLoc(
+         TemplateSpecializationTypeLoc TLoc);
+
+private:
+
+  MergeTemplateInstantiations *ConsumerInstance;
+
+  // specializations written inside the arguments of another one, as
+  // in S<S<int> >, are rewritten along with it
+  unsigned NestingLevel;
+};
+
+bool MergeTemplateInstantiationsVisitor::TraverseTemplateSpecializationTypeLoc(
+       TemplateSpecializationTypeLoc TLoc)
+{
+  if (NestingLevel == 0)
+    ConsumerInstance->handleTemplateSpecializationTypeLoc(TLoc);
+  NestingLevel++;
+  bool Ret = RecursiveASTVisitor<MergeTemplateInstantiationsVisitor>::
+               TraverseTemplateSpecializationTypeLoc(TLoc);
+  NestingLevel--;
+  return Ret;
+}
+
+class InstantiationCostVisitor : public
+  RecursiveASTVisitor<InstantiationCostVisitor> {
+public:
+
+  InstantiationCostVisitor(void)
+    : NumStmts(0)
+  { }
+
+  bool VisitStmt(Stmt *S) {
+    NumStmts++;
+    return true;
+  }
+
+  unsigned getNumStmts(void) const { return NumStmts; }
+
+private:
+
+  unsigned NumStmts;
+};
+
+void MergeTemplateInstantiations::Initialize(ASTContext &context)
+{
+  Transformation::Initialize(context);
+  CollectionVisitor = new MergeTemplateInstantiationsVisitor(this);
+}
+
+void MergeTemplateInstantiations::HandleTranslationUnit(ASTContext &Ctx)
+{
+  if (TransformationManager::isCXXLangOpt())
+    CollectionVisitor->TraverseDecl(Ctx.getTranslationUnitDecl());
+
+  for (TemplateToSpecsMap::const_iterator I = AllTemplateSpecs.begin(),
+       E = AllTemplateSpecs.end(); I != E; ++I)
+    addCandidate(I->first, I->second);
+  std::stable_sort(Candidates.begin(), Candidates.end(), hasMoreSaving);
+  ValidInstanceNum = Candidates.size();
+
+  if (QueryInstanceOnly)
+    return;
+
+  if (TransformationCounter > ValidInstanceNum) {
+    TransError = TransMaxInstanceError;
+    return;
+  }
+  if (ToCounter > ValidInstanceNum) {
+    TransError = TransToCounterTooBigError;
+    return;
+  }
+
+  Ctx.getDiagnostics().setSuppressAllDiagnostics(false);
+
+  int Last = (ToCounter > 0) ? ToCounter : TransformationCounter;
+  for (int I = TransformationCounter; I <= Last; ++I)
+    mergeInstantiations(Candidates[I-1]);
+
+  if (Ctx.getDiagnostics().hasErrorOccurred() ||
+      Ctx.getDiagnostics().hasFatalErrorOccurred())
+    TransError = TransInternalError;
+}
+
+void MergeTemplateInstantiations::handleTemplateSpecializationTypeLoc(
+       const TemplateSpecializationTypeLoc &TLoc)
+{
+  if (isInIncludedFile(TLoc.getBeginLoc()))
+    return;
+  SourceLocation LAngleLoc = TLoc.getLAngleLoc();
+  SourceLocation RAngleLoc = TLoc.getRAngleLoc();
+  if (LAngleLoc.isInvalid() || RAngleLoc.isInvalid() ||
+      LAngleLoc.isMacroID() || RAngleLoc.isMacroID())
+    return;
+
+  const TemplateSpecializationType *TST = TLoc.getTypePtr();
+  if (TST->isDependentType())
+    return;
+  const ClassTemplateDecl *CTD = dyn_cast_or_null<ClassTemplateDecl>(
+    TST->getTemplateName().getAsTemplateDecl());
+  if (!CTD)
+    return;
+  const RecordType *RT = TST->getAs<RecordType>();
+  if (!RT)
+    return;
+  const ClassTemplateSpecializationDecl *Spec =
+    dyn_cast<ClassTemplateSpecializationDecl>(RT->getDecl());
+  if (!Spec)
+    return;
+  AllTemplateSpecs[CTD->getCanonicalDecl()][Spec].push_back(TLoc);
+}
+
+bool MergeTemplateInstantiations::hasMoreSaving(const MergeCandidate &A,
+                                                const MergeCandidate &B)
+{
+  return A.Saving > B.Saving;
+}
+
+// Whether CTD has explicit or partial specializations or explicit
+// instantiations, whose written arguments must stay as they are.
+bool MergeTemplateInstantiations::hasWrittenSpecialization(
+       const ClassTemplateDecl *CTD)
+{
+  for (const ClassTemplateSpecializationDecl *Spec : CTD->specializations()) {
+    if (Spec->getSpecializationKind() != TSK_ImplicitInstantiation &&
+        Spec->getSpecializationKind() != TSK_Undeclared)
+      return true;
+  }
+  llvm::SmallVector<ClassTemplatePartialSpecializationDecl *, 4> PartialSpecs;
+  const_cast<ClassTemplateDecl *>(CTD)->getPartialSpecializations(PartialSpecs);
+  return !PartialSpecs.empty();
+}
+
+// An estimate of what it takes to instantiate Spec: one for each of
+// its members plus the statements of the member functions whose
+// definitions were instantiated.
+unsigned MergeTemplateInstantiations::getInstantiationCost(
+           const ClassTemplateSpecializationDecl *Spec)
+{
+  unsigned Cost = 0;
+  for (const Decl *D : Spec->decls()) {
+    Cost++;
+    const FunctionDecl *FD = dyn_cast<FunctionDecl>(D);
+    if (!FD || !FD->doesThisDeclarationHaveABody())
+      continue;
+    InstantiationCostVisitor V;
+    V.TraverseStmt(FD->getBody());
+    Cost += V.getNumStmts();
+  }
+  return Cost;
+}
+
+// The specialization written most often is kept, or the cheapest of
+// those written equally often.
+void MergeTemplateInstantiations::addCandidate(const ClassTemplateDecl *CTD,
+                                               const SpecToTypeLocsMap &Specs)
+{
+  if (Specs.size() < 2 || hasWrittenSpecialization(CTD))
+    return;
+
+  const ClassTemplateSpecializationDecl *Kept = NULL;
+  unsigned KeptUses = 0;
+  unsigned KeptCost = 0;
+  unsigned TotalCost = 0;
+  for (SpecToTypeLocsMap::const_iterator I = Specs.begin(), E = Specs.end();
+       I != E; ++I) {
+    unsigned Cost = getInstantiationCost(I->first);
+    unsigned Uses = I->second.size();
+    TotalCost += Cost;
+    if (!Kept || Uses > KeptUses || (Uses == KeptUses && Cost < KeptCost)) {
+      Kept = I->first;
+      KeptUses = Uses;
+      KeptCost = Cost;
+    }
+  }
+  Candidates.push_back(MergeCandidate(CTD, Kept, TotalCost - KeptCost));
+}
+
+void MergeTemplateInstantiations::mergeInstantiations(const MergeCandidate &C)
+{
+  const SpecToTypeLocsMap &Specs = AllTemplateSpecs[C.CTD];
+  SpecToTypeLocsMap::const_iterator KeptI = Specs.find(C.Kept);
+  TransAssert((KeptI != Specs.end()) && "Cannot find the kept spec!");
+  const TemplateSpecializationTypeLoc &KeptLoc = KeptI->second.front();
+  std::string ArgsStr;
+  RewriteHelper->getStringBetweenLocs(ArgsStr, KeptLoc.getLAngleLoc(),
+                                      KeptLoc.getRAngleLoc());
+  ArgsStr += ">";
+
+  for (SpecToTypeLocsMap::const_iterator I = Specs.begin(), E = Specs.end();
+       I != E; ++I) {
+    if (I->first == C.Kept)
+      continue;
+    for (const TemplateSpecializationTypeLoc &TLoc : I->second) {
+      TheRewriter.ReplaceText(SourceRange(TLoc.getLAngleLoc(),
+                                          TLoc.getRAngleLoc()), ArgsStr);
+    }
+  }
+}
+
+MergeTemplateInstantiations::~MergeTemplateInstantiations(void)
+{
+  delete CollectionVisitor;
+}
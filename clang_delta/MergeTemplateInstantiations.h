@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MERGE_TEMPLATE_INSTANTIATIONS_H
+#define MERGE_TEMPLATE_INSTANTIATIONS_H
+
+#include <vector>
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "clang/AST/TypeLoc.h"
+#include "Transformation.h"
+
+namespace clang {
+  class ASTContext;
+  class ClassTemplateDecl;
+  class ClassTemplateSpecializationDecl;
+}
+
+class MergeTemplateInstantiationsVisitor;
+
+class MergeTemplateInstantiations : public Transformation {
+friend class MergeTemplateInstantiationsVisitor;
+
+public:
+
+  MergeTemplateInstantiations(const char *TransName, const char *Desc)
+    : Transformation(TransName, Desc, /*MultipleRewrites*/true),
+      CollectionVisitor(NULL)
+  { }
+
+  ~MergeTemplateInstantiations(void);
+
+private:
+
+  struct MergeCandidate {
+    MergeCandidate(const clang::ClassTemplateDecl *D,
+                   const clang::ClassTemplateSpecializationDecl *K,
+                   unsigned S)
+      : CTD(D), Kept(K), Saving(S) { }
+
+    const clang::ClassTemplateDecl *CTD;
+    // the specialization that all of the others are turned into
+    const clang::ClassTemplateSpecializationDecl *Kept;
+    // the estimated cost of the instantiations that go away
+    unsigned Saving;
+  };
+
+  typedef llvm::SmallVector<clang::TemplateSpecializationTypeLoc, 4>
+            SpecTypeLocVector;
+
+  typedef llvm::MapVector<const clang::ClassTemplateSpecializationDecl *,
+                          SpecTypeLocVector> SpecToTypeLocsMap;
+
+  typedef llvm::MapVector<const clang::ClassTemplateDecl *,
+                          SpecToTypeLocsMap> TemplateToSpecsMap;
+
+  virtual void Initialize(clang::ASTContext &context);
+
+  virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
+
+  void handleTemplateSpecializationTypeLoc(
+         const clang::TemplateSpecializationTypeLoc &TLoc);
+
+  static bool hasMoreSaving(const MergeCandidate &A, const MergeCandidate &B);
+
+  bool hasWrittenSpecialization(const clang::ClassTemplateDecl *CTD);
+
+  unsigned getInstantiationCost(
+             const clang::ClassTemplateSpecializationDecl *Spec);
+
+  void addCandidate(const clang::ClassTemplateDecl *CTD,
+                    const SpecToTypeLocsMap &Specs);
+
+  void mergeInstantiations(const MergeCandidate &C);
+
+  MergeTemplateInstantiationsVisitor *CollectionVisitor;
+
+  // every written, non-dependent specialization of a class template in
+  // the main file, with the places where its template arguments are
+  // written, in source order
+  TemplateToSpecsMap AllTemplateSpecs;
+
+  // the templates with more than one specialization, the most costly
+  // first
+  std::vector<MergeCandidate> Candidates;
+
+  // Unimplemented
+  MergeTemplateInstantiations(void);
+
+  MergeTemplateInstantiations(const MergeTemplateInstantiations &);
+
+  void operator=(const MergeTemplateInstantiations &);
+};
+#endif
@@ -0,0 +1,340 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "RemoveUnexecutedCode.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+
+#include "TransformationManager.h"
+
+using namespace clang;
+
+static const char *DescriptionMsg =
+"Remove code that a run of the program did not execute, \
+according to the gcov file given with --coverage: empty the \
+body of a function that was never called, and delete a \
+statement, a branch of an if or the body of a loop none of \
+whose lines ran. Instances never overlap, and --to-counter \
+removes a whole range of them at once. \n";
+
+static RegisterTransformation<RemoveUnexecutedCode>
+         Trans("remove-unexecuted-code", DescriptionMsg);
+
+class RemoveUnexecutedCodeVisitor : public
+  RecursiveASTVisitor<RemoveUnexecutedCodeVisitor> {
+public:
+
+  explicit RemoveUnexecutedCodeVisitor(RemoveUnexecutedCode *Instance)
+    : ConsumerInstance(Instance)
+  { }
+
+  bool VisitFunctionDecl(FunctionDecl *FD);
+
+  bool VisitCompoundStmt(CompoundStmt *CS);
+
+  bool VisitIfStmt(IfStmt *IS);
+
+  bool VisitWhileStmt(WhileStmt *WS);
+
+  bool VisitForStmt(ForStmt *FS);
+
+  bool VisitCXXForRangeStmt(CXXForRangeStmt *FRS);
+
+private:
+
+  RemoveUnexecutedCode *ConsumerInstance;
+};
+
+bool RemoveUnexecutedCodeVisitor::VisitFunctionDecl(FunctionDecl *FD)
+{
+  if (ConsumerInstance->isInIncludedFile(FD) ||
+      !FD->doesThisDeclarationHaveABody() || FD->isMain())
+    return true;
+  if (const CompoundStmt *Body = dyn_cast<CompoundStmt>(FD->getBody()))
+    ConsumerInstance->addStmt(Body, "{}");
+  return true;
+}
+
+bool RemoveUnexecutedCodeVisitor::VisitCompoundStmt(CompoundStmt *CS)
+{
+  if (ConsumerInstance->isInIncludedFile(CS))
+    return true;
+  for (CompoundStmt::body_iterator I = CS->body_begin(),
+       E = CS->body_end(); I != E; ++I) {
+    // a declaration may still be used by code that ran
+    if (isa<DeclStmt>(*I) || isa<NullStmt>(*I))
+      continue;
+    ConsumerInstance->addStmt(*I, "");
+  }
+  return true;
+}
+
+bool RemoveUnexecutedCodeVisitor::VisitIfStmt(IfStmt *IS)
+{
+  if (ConsumerInstance->isInIncludedFile(IS))
+    return true;
+  ConsumerInstance->addStmt(IS->getThen(), ";");
+  if (IS->getElse())
+    ConsumerInstance->addStmt(IS->getElse(), ";");
+  return true;
+}
+
+bool RemoveUnexecutedCodeVisitor::VisitWhileStmt(WhileStmt *WS)
+{
+  if (!ConsumerInstance->isInIncludedFile(WS))
+    ConsumerInstance->addStmt(WS->getBody(), ";");
+  return true;
+}
+
+bool RemoveUnexecutedCodeVisitor::VisitForStmt(ForStmt *FS)
+{
+  if (!ConsumerInstance->isInIncludedFile(FS))
+    ConsumerInstance->addStmt(FS->getBody(), ";");
+  return true;
+}
+
+bool RemoveUnexecutedCodeVisitor::VisitCXXForRangeStmt(CXXForRangeStmt *FRS)
+{
+  if (!ConsumerInstance->isInIncludedFile(FRS))
+    ConsumerInstance->addStmt(FRS->getBody(), ";");
+  return true;
+}
+
+class BeginsBefore {
+public:
+
+  explicit BeginsBefore(SourceManager &SM)
+    : SrcManager(SM)
+  { }
+
+  bool operator()(const std::pair<SourceRange, std::string> &A,
+                  const std::pair<SourceRange, std::string> &B) const {
+    return SrcManager.isBeforeInTranslationUnit(A.first.getBegin(),
+                                                B.first.getBegin());
+  }
+
+private:
+
+  SourceManager &SrcManager;
+};
+
+void RemoveUnexecutedCode::Initialize(ASTContext &context)
+{
+  Transformation::Initialize(context);
+  CollectionVisitor = new RemoveUnexecutedCodeVisitor(this);
+}
+
+void RemoveUnexecutedCode::HandleTranslationUnit(ASTContext &Ctx)
+{
+  // without coverage there is nothing known to be unexecuted
+  if (readCoverage())
+    CollectionVisitor->TraverseDecl(Ctx.getTranslationUnitDecl());
+
+  // keep the outermost of the candidates that overlap
+  std::stable_sort(Candidates.begin(), Candidates.end(),
+                   BeginsBefore(*SrcManager));
+  SourceLocation LastEnd;
+  for (const UnexecutedCode &C : Candidates) {
+    if (LastEnd.isValid() &&
+        !SrcManager->isBeforeInTranslationUnit(LastEnd, C.first.getBegin()))
+      continue;
+    LastEnd = C.first.getEnd();
+    AllUnexecutedCode.push_back(C);
+  }
+  ValidInstanceNum = AllUnexecutedCode.size();
+
+  if (QueryInstanceOnly)
+    return;
+
+  if (TransformationCounter > ValidInstanceNum) {
+    TransError = TransMaxInstanceError;
+    return;
+  }
+  if (ToCounter > ValidInstanceNum) {
+    TransError = TransToCounterTooBigError;
+    return;
+  }
+
+  Ctx.getDiagnostics().setSuppressAllDiagnostics(false);
+
+  int Last = (ToCounter > 0) ? ToCounter : TransformationCounter;
+  for (int I = TransformationCounter; I <= Last; ++I) {
+    const UnexecutedCode &C = AllUnexecutedCode[I-1];
+    TheRewriter.ReplaceText(C.first, C.second);
+  }
+
+  if (Ctx.getDiagnostics().hasErrorOccurred() ||
+      Ctx.getDiagnostics().hasFatalErrorOccurred())
+    TransError = TransInternalError;
+}
+
+// Read the line counts from a file in gcov's text format, where each
+// line of the source is "count:line:text" and count is "-" for a line
+// without code and "#####" or "=====" for one that never ran.  A line
+// that shows up more than once, as lines of inline functions and
+// templates do, ran if any of its copies did.
+bool RemoveUnexecutedCode::readCoverage(void)
+{
+  if (CoverageFileName.empty())
+    return false;
+  std::ifstream In(CoverageFileName.c_str());
+  if (!In)
+    return false;
+
+  std::string Line;
+  while (std::getline(In, Line)) {
+    std::string::size_type CountEnd = Line.find(':');
+    if (CountEnd == std::string::npos)
+      continue;
+    std::string::size_type LineEnd = Line.find(':', CountEnd + 1);
+    if (LineEnd == std::string::npos)
+      continue;
+
+    std::string Count = Line.substr(0, CountEnd);
+    Count.erase(0, Count.find_first_not_of(' '));
+    unsigned LineNo = std::atoi(Line.c_str() + CountEnd + 1);
+    if (LineNo == 0 || Count.empty())
+      continue;
+
+    bool Executed;
+    if (Count == "#####" || Count == "=====")
+      Executed = false;
+    else if (std::isdigit(static_cast<unsigned char>(Count[0])))
+      Executed = true;
+    else
+      continue;
+    LineExecuted[LineNo] = LineExecuted[LineNo] || Executed;
+  }
+  return !LineExecuted.empty();
+}
+
+// The file range of S, provided that neither end of it is inside a
+// macro expansion.
+bool RemoveUnexecutedCode::getFileRange(const Stmt *S, SourceRange &Range)
+{
+  SourceLocation StartLoc = S->getBeginLoc();
+  SourceLocation EndLoc = S->getEndLoc();
+  if (StartLoc.isInvalid() || EndLoc.isInvalid())
+    return false;
+
+  const LangOptions &LangOpts = Context->getLangOpts();
+  if (StartLoc.isMacroID()) {
+    SourceLocation ExpansionLoc;
+    if (!Lexer::isAtStartOfMacroExpansion(StartLoc, *SrcManager,
+                                          LangOpts, &ExpansionLoc))
+      return false;
+    StartLoc = ExpansionLoc;
+  }
+  if (EndLoc.isMacroID()) {
+    SourceLocation ExpansionLoc;
+    if (!Lexer::isAtEndOfMacroExpansion(EndLoc, *SrcManager,
+                                        LangOpts, &ExpansionLoc))
+      return false;
+    EndLoc = ExpansionLoc;
+  }
+  if (StartLoc.isMacroID() || EndLoc.isMacroID())
+    return false;
+  if (SrcManager->getFileID(StartLoc) != SrcManager->getFileID(EndLoc))
+    return false;
+
+  Range = SourceRange(StartLoc, EndLoc);
+  return true;
+}
+
+// Whether gcov has counts for some of the lines from StartLoc to EndLoc
+// and all of them are zero.
+bool RemoveUnexecutedCode::isUnexecuted(SourceLocation StartLoc,
+                                        SourceLocation EndLoc)
+{
+  unsigned StartLine = SrcManager->getExpansionLineNumber(StartLoc);
+  unsigned EndLine = SrcManager->getExpansionLineNumber(EndLoc);
+  std::map<unsigned, bool>::const_iterator I =
+    LineExecuted.lower_bound(StartLine);
+  bool Counted = false;
+  for (; I != LineExecuted.end() && I->first <= EndLine; ++I) {
+    if (I->second)
+      return false;
+    Counted = true;
+  }
+  return Counted;
+}
+
+// Whether S has a goto label, or a case label that belongs to a switch
+// outside of S, either of which could be jumped to from code that ran.
+bool RemoveUnexecutedCode::hasOutsideLabel(const Stmt *S, bool InSwitch)
+{
+  if (!S)
+    return false;
+  if (isa<LabelStmt>(S) || (isa<SwitchCase>(S) && !InSwitch))
+    return true;
+  if (isa<SwitchStmt>(S))
+    InSwitch = true;
+  for (Stmt::const_child_iterator I = S->child_begin(),
+       E = S->child_end(); I != E; ++I) {
+    if (hasOutsideLabel(*I, InSwitch))
+      return true;
+  }
+  return false;
+}
+
+// Record S as a candidate to be replaced by Str if none of its lines
+// ran.  The lines of a compound statement are those of what it holds,
+// since its braces usually share a line with code that did run, like
+// "if (x) {" or "} else {"; any other statement takes its semicolon
+// along with it.
+void RemoveUnexecutedCode::addStmt(const Stmt *S, const std::string &Str)
+{
+  if (!S || hasOutsideLabel(S, false))
+    return;
+
+  SourceRange Range;
+  if (!getFileRange(S, Range))
+    return;
+
+  if (const CompoundStmt *CS = dyn_cast<CompoundStmt>(S)) {
+    if (CS->body_empty())
+      return;
+    if (!isUnexecuted(CS->body_front()->getBeginLoc(),
+                      CS->body_back()->getEndLoc()))
+      return;
+  }
+  else {
+    if (!isUnexecuted(Range.getBegin(), Range.getEnd()))
+      return;
+    SourceLocation AfterLoc = RewriteHelper->getEndLocationFromBegin(Range);
+    if (AfterLoc.isValid()) {
+      const char *Buf = SrcManager->getCharacterData(AfterLoc);
+      int Offset = 0;
+      while (isspace(static_cast<unsigned char>(Buf[Offset])))
+        Offset++;
+      if (Buf[Offset] == ';')
+        Range.setEnd(AfterLoc.getLocWithOffset(Offset));
+    }
+  }
+
+  Candidates.push_back(UnexecutedCode(Range, Str));
+}
+
+RemoveUnexecutedCode::~RemoveUnexecutedCode(void)
+{
+  delete CollectionVisitor;
+}
@@ -0,0 +1,79 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef REMOVE_UNEXECUTED_CODE_H
+#define REMOVE_UNEXECUTED_CODE_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "clang/Basic/SourceLocation.h"
+#include "Transformation.h"
+
+namespace clang {
+  class ASTContext;
+  class Stmt;
+}
+
+class RemoveUnexecutedCodeVisitor;
+
+class RemoveUnexecutedCode : public Transformation {
+friend class RemoveUnexecutedCodeVisitor;
+
+public:
+
+  RemoveUnexecutedCode(const char *TransName, const char *Desc)
+    : Transformation(TransName, Desc, /*MultipleRewrites*/true),
+      CollectionVisitor(NULL)
+  { }
+
+  ~RemoveUnexecutedCode(void);
+
+private:
+
+  typedef std::pair<clang::SourceRange, std::string> UnexecutedCode;
+
+  virtual void Initialize(clang::ASTContext &context);
+
+  virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
+
+  bool readCoverage(void);
+
+  bool getFileRange(const clang::Stmt *S, clang::SourceRange &Range);
+
+  bool isUnexecuted(clang::SourceLocation StartLoc,
+                    clang::SourceLocation EndLoc);
+
+  bool hasOutsideLabel(const clang::Stmt *S, bool InSwitch);
+
+  void addStmt(const clang::Stmt *S, const std::string &Str);
+
+  RemoveUnexecutedCodeVisitor *CollectionVisitor;
+
+  // line number -> whether gcov counted it as executed; lines without
+  // any code are not in the map
+  std::map<unsigned, bool> LineExecuted;
+
+  // candidates in the order they were found, which puts every enclosing
+  // one before those inside it
+  std::vector<UnexecutedCode> Candidates;
+
+  // the candidates that do not overlap each other, in source order
+  std::vector<UnexecutedCode> AllUnexecutedCode;
+
+  // Unimplemented
+  RemoveUnexecutedCode(void);
+
+  RemoveUnexecutedCode(const RemoveUnexecutedCode &);
+
+  void operator=(const RemoveUnexecutedCode &);
+};
+#endif
@@ -0,0 +1,285 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "RemoveUnusedStdMembers.h"
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Attr.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/Basic/SourceManager.h"
+
+#include "TransformationManager.h"
+
+using namespace clang;
+
+static const char *DescriptionMsg =
+"Cut a class template of the standard library, or of one of the \
+reserved namespaces such as __gnu_cxx, down to the members that \
+the program uses. Each instance is one class template whose \
+definition has been inlined into the main file, e.g. by \
+pass_include_includes; the transformation deletes every member \
+function and member function template, along with its out-of-line \
+definitions, that none of the template's instantiations refers to. \
+Destructors, virtual functions and defaulted or deleted functions \
+are kept. --to-counter prunes a whole range of templates at once. \n";
+
+static RegisterTransformation<RemoveUnusedStdMembers>
+         Trans("remove-unused-std-members", DescriptionMsg);
+
+class RemoveUnusedStdMembersVisitor : public
+  RecursiveASTVisitor<RemoveUnusedStdMembersVisitor> {
+public:
+
+  explicit RemoveUnusedStdMembersVisitor(RemoveUnusedStdMembers *Instance)
+    : ConsumerInstance(Instance)
+  { }
+
+  bool VisitClassTemplateDecl(ClassTemplateDecl *CTD);
+
+private:
+
+  RemoveUnusedStdMembers *ConsumerInstance;
+};
+
+bool RemoveUnusedStdMembersVisitor::VisitClassTemplateDecl(
+       ClassTemplateDecl *CTD)
+{
+  // member templates of classes are left to the class around them
+  if (ConsumerInstance->isInIncludedFile(CTD) ||
+      !CTD->isThisDeclarationADefinition() ||
+      !CTD->getDeclContext()->isFileContext() ||
+      !ConsumerInstance->isLibraryDecl(CTD))
+    return true;
+  ConsumerInstance->handleClassTemplate(CTD);
+  return true;
+}
+
+void RemoveUnusedStdMembers::Initialize(ASTContext &context)
+{
+  Transformation::Initialize(context);
+  CollectionVisitor = new RemoveUnusedStdMembersVisitor(this);
+}
+
+void RemoveUnusedStdMembers::HandleTranslationUnit(ASTContext &Ctx)
+{
+  if (TransformationManager::isCXXLangOpt())
+    CollectionVisitor->TraverseDecl(Ctx.getTranslationUnitDecl());
+  ValidInstanceNum = AllUnusedMembers.size();
+
+  if (QueryInstanceOnly)
+    return;
+
+  if (TransformationCounter > ValidInstanceNum) {
+    TransError = TransMaxInstanceError;
+    return;
+  }
+  if (ToCounter > ValidInstanceNum) {
+    TransError = TransToCounterTooBigError;
+    return;
+  }
+
+  Ctx.getDiagnostics().setSuppressAllDiagnostics(false);
+
+  int Last = (ToCounter > 0) ? ToCounter : TransformationCounter;
+  for (int I = TransformationCounter; I <= Last; ++I) {
+    for (const SourceRange &Range : AllUnusedMembers[I-1])
+      TheRewriter.RemoveText(Range);
+  }
+
+  if (Ctx.getDiagnostics().hasErrorOccurred() ||
+      Ctx.getDiagnostics().hasFatalErrorOccurred())
+    TransError = TransInternalError;
+}
+
+// Whether D is inside namespace std, or inside a namespace whose name
+// is reserved to the implementation, like __gnu_cxx or libc++'s __1.
+bool RemoveUnusedStdMembers::isLibraryDecl(const Decl *D)
+{
+  for (const DeclContext *Ctx = D->getDeclContext(); Ctx;
+       Ctx = Ctx->getParent()) {
+    const NamespaceDecl *ND = dyn_cast<NamespaceDecl>(Ctx);
+    if (!ND)
+      continue;
+    if (ND->isStdNamespace())
+      return true;
+    const IdentifierInfo *II = ND->getIdentifier();
+    if (II && II->getName().startswith("__"))
+      return true;
+  }
+  return false;
+}
+
+// Whether MD, a member function of the pattern of CTD, is referred to
+// by the pattern or by its counterpart in one of the instantiations.
+// Instantiating a class declares all of its members, but only those
+// that are referred to are marked as such.
+bool RemoveUnusedStdMembers::isUsedMember(const ClassTemplateDecl *CTD,
+                                          const CXXMethodDecl *MD)
+{
+  if (MD->isReferenced() || MD->isUsed(false))
+    return true;
+  const FunctionDecl *CanonicalMD = MD->getCanonicalDecl();
+  for (const ClassTemplateSpecializationDecl *Spec : CTD->specializations()) {
+    if (Spec->isExplicitSpecialization())
+      continue;
+    for (const Decl *D : Spec->decls()) {
+      const CXXMethodDecl *SpecMD = dyn_cast<CXXMethodDecl>(D);
+      if (!SpecMD)
+        continue;
+      const FunctionDecl *Pattern = SpecMD->getInstantiatedFromMemberFunction();
+      if (Pattern && Pattern->getCanonicalDecl() == CanonicalMD &&
+          (SpecMD->isReferenced() || SpecMD->isUsed(false)))
+        return true;
+    }
+  }
+  return false;
+}
+
+bool RemoveUnusedStdMembers::isUsedTemplate(const FunctionTemplateDecl *FTD)
+{
+  if (FTD->isReferenced() || FTD->getTemplatedDecl()->isReferenced())
+    return true;
+  for (const FunctionDecl *Spec : FTD->specializations()) {
+    if (Spec->isReferenced() || Spec->isUsed(false))
+      return true;
+  }
+  return false;
+}
+
+bool RemoveUnusedStdMembers::isUsedMemberTemplate(
+       const ClassTemplateDecl *CTD, const FunctionTemplateDecl *FTD)
+{
+  if (isUsedTemplate(FTD))
+    return true;
+  const FunctionTemplateDecl *CanonicalFTD = FTD->getCanonicalDecl();
+  for (const ClassTemplateSpecializationDecl *Spec : CTD->specializations()) {
+    if (Spec->isExplicitSpecialization())
+      continue;
+    for (const Decl *D : Spec->decls()) {
+      const FunctionTemplateDecl *SpecFTD = dyn_cast<FunctionTemplateDecl>(D);
+      if (!SpecFTD)
+        continue;
+      const FunctionTemplateDecl *Pattern =
+        SpecFTD->getInstantiatedFromMemberTemplate();
+      if (Pattern && Pattern->getCanonicalDecl() == CanonicalFTD &&
+          isUsedTemplate(SpecFTD))
+        return true;
+    }
+  }
+  return false;
+}
+
+// Destructors and virtual functions are used without being named, and
+// a defaulted or deleted member may stand in the way of an implicit one.
+bool RemoveUnusedStdMembers::isRemovableMember(const FunctionDecl *FD)
+{
+  if (FD->isImplicit() || FD->isDeleted() || FD->isDefaulted() ||
+      isa<CXXDestructorDecl>(FD))
+    return false;
+  const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(FD);
+  return !MD || !MD->isVirtual();
+}
+
+// The range of one declaration of FD, from its template header, if any,
+// to the closing brace of its body or its semicolon.  Attributes that
+// come from a macro before the declaration, like _GLIBCXX_NODISCARD,
+// go along with it; a declaration with an attribute spelled out before
+// it, or that is not all in the main file, is not removed.
+bool RemoveUnusedStdMembers::getDeclRange(const FunctionDecl *FD,
+                                          SourceRange &Range)
+{
+  SourceLocation StartLoc = FD->getOuterLocStart();
+  if (const FunctionTemplateDecl *FTD = FD->getDescribedFunctionTemplate()) {
+    SourceLocation TemplateLoc = FTD->getBeginLoc();
+    if (TemplateLoc.isValid() && StartLoc.isValid() &&
+        SrcManager->isBeforeInTranslationUnit(TemplateLoc, StartLoc))
+      StartLoc = TemplateLoc;
+  }
+  SourceLocation EndLoc = FD->getSourceRange().getEnd();
+  if (StartLoc.isInvalid() || EndLoc.isInvalid())
+    return false;
+  if (StartLoc.isMacroID())
+    StartLoc = SrcManager->getExpansionLoc(StartLoc);
+  if (EndLoc.isMacroID())
+    EndLoc = SrcManager->getExpansionLoc(EndLoc);
+
+  for (const Attr *A : FD->attrs()) {
+    if (A->isImplicit() || A->isInherited())
+      continue;
+    SourceLocation AttrLoc = A->getLocation();
+    if (AttrLoc.isInvalid())
+      continue;
+    bool FromMacro = AttrLoc.isMacroID();
+    if (FromMacro)
+      AttrLoc = SrcManager->getExpansionLoc(AttrLoc);
+    if (!SrcManager->isBeforeInTranslationUnit(AttrLoc, StartLoc))
+      continue;
+    if (!FromMacro)
+      return false;
+    StartLoc = AttrLoc;
+  }
+
+  if (!FD->doesThisDeclarationHaveABody())
+    EndLoc = RewriteHelper->getLocationUntil(EndLoc, ';');
+  if (!SrcManager->isWrittenInMainFile(StartLoc) ||
+      !SrcManager->isWrittenInMainFile(EndLoc))
+    return false;
+
+  Range = SourceRange(StartLoc, EndLoc);
+  return true;
+}
+
+// Add the ranges of all of the declarations of FD, or none of them if
+// one of them cannot be removed.
+void RemoveUnusedStdMembers::addMember(const FunctionDecl *FD,
+                                       MemberRanges &Ranges)
+{
+  MemberRanges Decls;
+  for (const FunctionDecl *Redecl : FD->redecls()) {
+    SourceRange Range;
+    if (!getDeclRange(Redecl, Range))
+      return;
+    Decls.push_back(Range);
+  }
+  Ranges.insert(Ranges.end(), Decls.begin(), Decls.end());
+}
+
+void RemoveUnusedStdMembers::handleClassTemplate(const ClassTemplateDecl *CTD)
+{
+  MemberRanges Ranges;
+  for (const Decl *D : CTD->getTemplatedDecl()->decls()) {
+    const FunctionDecl *FD = NULL;
+    if (const FunctionTemplateDecl *FTD = dyn_cast<FunctionTemplateDecl>(D)) {
+      if (isUsedMemberTemplate(CTD, FTD))
+        continue;
+      FD = FTD->getTemplatedDecl();
+    }
+    else if (const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(D)) {
+      if (isUsedMember(CTD, MD))
+        continue;
+      FD = MD;
+    }
+    if (FD && isRemovableMember(FD))
+      addMember(FD, Ranges);
+  }
+  if (!Ranges.empty())
+    AllUnusedMembers.push_back(Ranges);
+}
+
+RemoveUnusedStdMembers::~RemoveUnusedStdMembers(void)
+{
+  delete CollectionVisitor;
+}
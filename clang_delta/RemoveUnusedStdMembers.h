@@ -0,0 +1,80 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef REMOVE_UNUSED_STD_MEMBERS_H
+#define REMOVE_UNUSED_STD_MEMBERS_H
+
+#include <vector>
+#include "clang/Basic/SourceLocation.h"
+#include "Transformation.h"
+
+namespace clang {
+  class ASTContext;
+  class Decl;
+  class FunctionDecl;
+  class FunctionTemplateDecl;
+  class CXXMethodDecl;
+  class ClassTemplateDecl;
+}
+
+class RemoveUnusedStdMembersVisitor;
+
+class RemoveUnusedStdMembers : public Transformation {
+friend class RemoveUnusedStdMembersVisitor;
+
+public:
+
+  RemoveUnusedStdMembers(const char *TransName, const char *Desc)
+    : Transformation(TransName, Desc, /*MultipleRewrites*/true),
+      CollectionVisitor(NULL)
+  { }
+
+  ~RemoveUnusedStdMembers(void);
+
+private:
+
+  typedef std::vector<clang::SourceRange> MemberRanges;
+
+  virtual void Initialize(clang::ASTContext &context);
+
+  virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
+
+  bool isLibraryDecl(const clang::Decl *D);
+
+  bool isUsedMember(const clang::ClassTemplateDecl *CTD,
+                    const clang::CXXMethodDecl *MD);
+
+  bool isUsedTemplate(const clang::FunctionTemplateDecl *FTD);
+
+  bool isUsedMemberTemplate(const clang::ClassTemplateDecl *CTD,
+                            const clang::FunctionTemplateDecl *FTD);
+
+  bool isRemovableMember(const clang::FunctionDecl *FD);
+
+  bool getDeclRange(const clang::FunctionDecl *FD, clang::SourceRange &Range);
+
+  void addMember(const clang::FunctionDecl *FD, MemberRanges &Ranges);
+
+  void handleClassTemplate(const clang::ClassTemplateDecl *CTD);
+
+  RemoveUnusedStdMembersVisitor *CollectionVisitor;
+
+  // for each class template with unused members, in source order, the
+  // ranges of all of their declarations and out-of-line definitions
+  std::vector<MemberRanges> AllUnusedMembers;
+
+  // Unimplemented
+  RemoveUnusedStdMembers(void);
+
+  RemoveUnusedStdMembers(const RemoveUnusedStdMembers &);
+
+  void operator=(const RemoveUnusedStdMembers &);
+};
+#endif
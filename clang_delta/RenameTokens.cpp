@@ -0,0 +1,168 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "RenameTokens.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+
+#include "TransformationManager.h"
+
+using namespace clang;
+
+static const char *DescriptionMsg =
+"Rename an identifier to the shortest name that is not used yet, \
+everywhere it is written in the main file, like clex's rename-toks. \
+Each instance is one identifier whose name would get shorter or sort \
+earlier. The transformation only looks at tokens, so clang_delta \
+lexes the file without preprocessing or parsing it, and broken \
+variants are handled as well as valid ones. Keywords, main, names \
+reserved to the implementation and the names in directives other \
+than #define, #undef and the conditionals are left alone. \n";
+
+static RegisterTransformation<RenameTokens>
+         Trans("rename-tokens", DescriptionMsg);
+
+// Used when the transformation is queried along with others that need
+// the AST.
+void RenameTokens::HandleTranslationUnit(ASTContext &Ctx)
+{
+  HandleTokens();
+}
+
+void RenameTokens::HandleTokens()
+{
+  IdentifierTable Idents(TheRewriter.getLangOpts());
+  collectIdentifiers(Idents);
+  findUnusedName(Idents);
+  for (NameToLocsMap::const_iterator I = AllNames.begin(),
+       E = AllNames.end(); I != E; ++I) {
+    if (shouldBeRenamed(I->first))
+      Candidates.push_back(I->first);
+  }
+  ValidInstanceNum = Candidates.size();
+
+  if (QueryInstanceOnly)
+    return;
+
+  if (TransformationCounter > ValidInstanceNum) {
+    TransError = TransMaxInstanceError;
+    return;
+  }
+
+  StringRef Name = Candidates[TransformationCounter-1];
+  for (const SourceLocation &Loc : AllNames[Name])
+    TheRewriter.ReplaceText(Loc, Name.size(), NewName);
+}
+
+// Raw-lex the main file. Comments are skipped, and in raw mode every
+// identifier, keywords included, comes as a raw_identifier that points
+// into the buffer of the file.
+void RenameTokens::collectIdentifiers(IdentifierTable &Idents)
+{
+  FileID MainFileID = SrcManager->getMainFileID();
+  const llvm::MemoryBuffer *MainBuf = SrcManager->getBuffer(MainFileID);
+  Lexer RawLexer(MainFileID, MainBuf, *SrcManager, TheRewriter.getLangOpts());
+
+  bool AfterHash = false;
+  bool SkipLine = false;
+  Token Tok;
+  RawLexer.LexFromRawLexer(Tok);
+  for (; Tok.isNot(tok::eof); RawLexer.LexFromRawLexer(Tok)) {
+    bool IsIdentifier = Tok.is(tok::raw_identifier);
+    if (IsIdentifier)
+      UsedNames.insert(Tok.getRawIdentifier());
+
+    if (Tok.isAtStartOfLine()) {
+      SkipLine = false;
+      AfterHash = Tok.is(tok::hash);
+      if (AfterHash)
+        continue;
+    }
+    // The operands of #include, #pragma, #line and the like are not
+    // names of the program; a line marker has a number instead of the
+    // name of the directive
+    if (AfterHash) {
+      AfterHash = false;
+      SkipLine = !IsIdentifier ||
+                 !isDirectiveWithNames(Tok.getRawIdentifier());
+      continue;
+    }
+    if (SkipLine || !IsIdentifier)
+      continue;
+
+    StringRef Name = Tok.getRawIdentifier();
+    if (isRenamableName(Name, Idents))
+      AllNames[Name].push_back(Tok.getLocation());
+  }
+}
+
+bool RenameTokens::isDirectiveWithNames(StringRef Directive)
+{
+  return Directive == "define" || Directive == "undef" ||
+         Directive == "if" || Directive == "ifdef" ||
+         Directive == "ifndef" || Directive == "elif";
+}
+
+// Names reserved to the implementation, like __attribute__ or _Bool,
+// are most likely declared by it rather than by the program.
+bool RenameTokens::isRenamableName(StringRef Name, IdentifierTable &Idents)
+{
+  if (Name == "main" || Name == "defined")
+    return false;
+  if (Name.startswith("__") ||
+      (Name.size() > 1 && Name[0] == '_' &&
+       Name[1] >= 'A' && Name[1] <= 'Z'))
+    return false;
+  return !isKeyword(Name, Idents);
+}
+
+bool RenameTokens::isKeyword(StringRef Name, IdentifierTable &Idents)
+{
+  return Idents.get(Name).getTokenID() != tok::identifier;
+}
+
+// The first of a, b, ..., z, aa, ab, ... that is neither written in the
+// main file nor a keyword.
+void RenameTokens::findUnusedName(IdentifierTable &Idents)
+{
+  NewName = "a";
+  while (UsedNames.count(NewName) || isKeyword(NewName, Idents)) {
+    int Pos = NewName.size() - 1;
+    while (Pos >= 0 && NewName[Pos] == 'z') {
+      NewName[Pos] = 'a';
+      Pos--;
+    }
+    if (Pos < 0)
+      NewName.insert(NewName.begin(), 'a');
+    else
+      NewName[Pos]++;
+  }
+}
+
+// A name made of lowercase letters only is renamed only if that makes
+// it shorter or makes it sort earlier, so that renaming always makes
+// progress.
+bool RenameTokens::shouldBeRenamed(StringRef Name)
+{
+  for (char C : Name) {
+    if (C < 'a' || C > 'z')
+      return true;
+  }
+  if (NewName.size() > Name.size())
+    return false;
+  return NewName.size() < Name.size() || Name.compare(NewName) > 0;
+}
@@ -0,0 +1,83 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019 The University of Utah
+// All rights reserved.
+//
+// This file is distributed under the University of Illinois Open Source
+// License.  See the file COPYING for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RENAME_TOKENS_H
+#define RENAME_TOKENS_H
+
+#include <string>
+#include <vector>
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "clang/Basic/SourceLocation.h"
+#include "Transformation.h"
+
+namespace clang {
+  class ASTContext;
+  class IdentifierTable;
+}
+
+class RenameTokens : public Transformation {
+
+public:
+
+  RenameTokens(const char *TransName, const char *Desc)
+    : Transformation(TransName, Desc)
+  { }
+
+  virtual bool isTokenOnly() {
+    return true;
+  }
+
+  virtual void HandleTokens();
+
+private:
+
+  typedef llvm::SmallVector<clang::SourceLocation, 8> LocVector;
+
+  typedef llvm::MapVector<llvm::StringRef, LocVector> NameToLocsMap;
+
+  virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
+
+  void collectIdentifiers(clang::IdentifierTable &Idents);
+
+  bool isDirectiveWithNames(llvm::StringRef Directive);
+
+  bool isRenamableName(llvm::StringRef Name, clang::IdentifierTable &Idents);
+
+  bool isKeyword(llvm::StringRef Name, clang::IdentifierTable &Idents);
+
+  void findUnusedName(clang::IdentifierTable &Idents);
+
+  bool shouldBeRenamed(llvm::StringRef Name);
+
+  // every identifier of the main file that may be renamed, in the order
+  // of their first appearance, with all of the places where it is written
+  NameToLocsMap AllNames;
+
+  // the names of AllNames that would get shorter or sort earlier
+  std::vector<llvm::StringRef> Candidates;
+
+  // all of the identifiers of the main file, including those that must
+  // stay as they are
+  llvm::StringSet<> UsedNames;
+
+  // the shortest name that is neither used nor a keyword
+  std::string NewName;
+
+  // Unimplemented
+  RenameTokens(void);
+
+  RenameTokens(const RenameTokens &);
+
+  void operator=(const RenameTokens &);
+};
+#endif
@@ -92,6 +92,14 @@ void Transformation::Initialize(ASTContext &context)
   RewriteHelper = RewriteUtils::GetInstance(&TheRewriter);
 }
 
+void Transformation::InitializeTokens(SourceManager &SM,
+                                      const LangOptions &LangOpts)
+{
+  SrcManager = &SM;
+  TheRewriter.setSourceMgr(SM, LangOpts);
+  RewriteHelper = RewriteUtils::GetInstance(&TheRewriter);
+}
+
 void Transformation::outputTransformedSource(llvm::raw_ostream &OutStream)
 {
   FileID MainFileID = SrcManager->getMainFileID();
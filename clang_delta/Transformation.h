@@ -23,6 +23,7 @@ namespace clang {
   class CompilerInstance;
   class ASTContext;
   class SourceManager;
+  class LangOptions;
   class Decl;
   class Expr;
   class ArrayType;
@@ -143,6 +144,10 @@ public:
     CheckReference = true;
   }
 
+  void setCoverageFileName(const std::string &FileName) {
+    CoverageFileName = FileName;
+  }
+
   bool transSuccess() {
     return (TransError == TransSuccess);
   }
@@ -174,6 +179,18 @@ public:
     return false;
   }
 
+  // Whether the transformation works from the tokens of the main file
+  // alone. If all of the transformations of a run do, the file is only
+  // raw-lexed and HandleTokens is called instead of HandleTranslationUnit.
+  virtual bool isTokenOnly() {
+    return false;
+  }
+
+  void InitializeTokens(clang::SourceManager &SM,
+                        const clang::LangOptions &LangOpts);
+
+  virtual void HandleTokens() { }
+
 protected:
 
   typedef llvm::SmallVector<unsigned int, 10> IndexVector;
@@ -338,6 +355,8 @@ protected:
   bool CheckReference;
 
   std::string ReferenceValue;
+
+  std::string CoverageFileName;
 };
 
 class TransNameQueryVisitor;
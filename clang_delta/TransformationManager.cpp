@@ -14,12 +14,17 @@
 
 #include "TransformationManager.h"
 
+#include <chrono>
+#include <cstdlib>
 #include <sstream>
+#include <thread>
 
+#include "clang/AST/DeclGroup.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/MultiplexConsumer.h"
 #include "clang/Parse/ParseAST.h"
 
 #include "Transformation.h"
@@ -28,6 +33,64 @@ using namespace clang;
 
 int TransformationManager::ErrorInvalidCounter = 1;
 
+int TransformationManager::ErrorGaveUp = 2;
+
+namespace {
+
+// Watches the parse for errors, so that clang_delta can give up on a
+// broken variant instead of recovering from one error after another.
+// Diagnostics stay suppressed as they are without a budget, because
+// transformations take any error that has been reported as a failure of
+// their own; suppressed errors still trip a DiagnosticErrorTrap, though.
+// The trap is checked whenever a declaration has been parsed, and each
+// declaration with errors in it counts as one error.
+class ErrorBudgetConsumer : public ASTConsumer {
+public:
+  ErrorBudgetConsumer(DiagnosticsEngine &Diags, unsigned Max)
+    : Trap(Diags),
+      MaxErrors(Max),
+      NumErrors(0)
+  { }
+
+  bool HandleTopLevelDecl(DeclGroupRef D) override {
+    checkErrors();
+    return true;
+  }
+
+  void HandleInlineFunctionDefinition(FunctionDecl *D) override {
+    checkErrors();
+  }
+
+  void HandleTagDeclDefinition(TagDecl *D) override {
+    checkErrors();
+  }
+
+  void HandleCXXImplicitFunctionInstantiation(FunctionDecl *D) override {
+    checkErrors();
+  }
+
+  void HandleTranslationUnit(ASTContext &Ctx) override {
+    checkErrors();
+  }
+
+private:
+  void checkErrors() {
+    if (!Trap.hasErrorOccurred())
+      return;
+    Trap.reset();
+    if (++NumErrors > MaxErrors)
+      std::_Exit(TransformationManager::ErrorGaveUp);
+  }
+
+  DiagnosticErrorTrap Trap;
+
+  unsigned MaxErrors;
+
+  unsigned NumErrors;
+};
+
+}
+
 TransformationManager* TransformationManager::Instance;
 
 std::map<std::string, Transformation *> *
@@ -90,6 +153,14 @@ bool TransformationManager::initializeCompilerInstance(std::string &ErrorMsg)
   
   ClangInstance->createDiagnostics();
 
+  if (TimeLimit > 0) {
+    int Seconds = TimeLimit;
+    std::thread([Seconds]() {
+      std::this_thread::sleep_for(std::chrono::seconds(Seconds));
+      std::_Exit(TransformationManager::ErrorGaveUp);
+    }).detach();
+  }
+
   TargetOptions &TargetOpts = ClangInstance->getTargetOpts();
   PreprocessorOptions &PPOpts = ClangInstance->getPreprocessorOpts();
   if (const char *env = getenv("CREDUCE_TARGET_TRIPLE")) {
@@ -142,6 +213,15 @@ bool TransformationManager::initializeCompilerInstance(std::string &ErrorMsg)
     return false;
   }
 
+  LangOptions &LangOpts = ClangInstance->getLangOpts();
+  if (MaxInstantiationDepth > 0)
+    LangOpts.InstantiationDepth = MaxInstantiationDepth;
+  // Typo correction is the most expensive part of recovering from the
+  // errors that most variants contain; don't bother once we are
+  // counting them anyway
+  if (MaxErrors > 0)
+    LangOpts.SpellChecking = false;
+
   TargetInfo *Target = 
     TargetInfo::CreateTargetInfo(ClangInstance->getDiagnostics(),
                                  ClangInstance->getInvocation().TargetOpts);
@@ -164,25 +244,71 @@ bool TransformationManager::initializeCompilerInstance(std::string &ErrorMsg)
 
   ClangInstance->createFileManager();
   ClangInstance->createSourceManager(ClangInstance->getFileManager());
-  ClangInstance->createPreprocessor(TU_Complete);
-
-  DiagnosticConsumer &DgClient = ClangInstance->getDiagnosticClient();
-  DgClient.BeginSourceFile(ClangInstance->getLangOpts(),
-                           &ClangInstance->getPreprocessor());
-  ClangInstance->createASTContext();
 
   // It's not elegant to initialize these two here... Ideally, we 
   // would put them in doTransformation, but we need these two
   // flags being set before Transformation::Initialize, which
-  // is invoked through ClangInstance->setASTConsumer.
+  // is invoked through ClangInstance->setASTConsumer
+  // or InitializeTokens.
   if (DoReplacement)
     CurrentTransformationImpl->setReplacement(Replacement);
   if (CheckReference)
     CurrentTransformationImpl->setReferenceValue(ReferenceValue);
+  if (!CoverageFileName.empty())
+    CurrentTransformationImpl->setCoverageFileName(CoverageFileName);
 
   assert(CurrentTransformationImpl && "Bad transformation instance!");
-  ClangInstance->setASTConsumer(
-    std::unique_ptr<ASTConsumer>(CurrentTransformationImpl));
+  TokenOnly = isTokenOnlyRun();
+  if (TokenOnly) {
+    // Neither a preprocessor nor an AST is needed to lex the main file
+    if (QueryTransformations.size() > 1) {
+      for (auto &QT : QueryTransformations)
+        QT.second->InitializeTokens(ClangInstance->getSourceManager(),
+                                    LangOpts);
+    }
+    else {
+      CurrentTransformationImpl->InitializeTokens(
+        ClangInstance->getSourceManager(), LangOpts);
+    }
+    if (!ClangInstance->InitializeSourceManager(
+           FrontendInputFile(SrcFileName, IK))) {
+      ErrorMsg = "Cannot open source file!";
+      return false;
+    }
+    return true;
+  }
+
+  ClangInstance->createPreprocessor(TU_Complete);
+
+  DiagnosticConsumer &DgClient = ClangInstance->getDiagnosticClient();
+  DgClient.BeginSourceFile(ClangInstance->getLangOpts(),
+                           &ClangInstance->getPreprocessor());
+  ClangInstance->createASTContext();
+
+  if (QueryTransformations.size() > 1 || MaxErrors > 0) {
+    // Every queried transformation collects its candidates from the
+    // same AST, so the source is parsed only once. The error budget
+    // comes first so that it can give up before a transformation
+    // goes to work.
+    std::vector<std::unique_ptr<ASTConsumer> > Consumers;
+    if (MaxErrors > 0)
+      Consumers.push_back(std::unique_ptr<ASTConsumer>(
+        new ErrorBudgetConsumer(ClangInstance->getDiagnostics(), MaxErrors)));
+    if (QueryTransformations.size() > 1) {
+      for (auto &QT : QueryTransformations)
+        Consumers.push_back(std::unique_ptr<ASTConsumer>(QT.second));
+    }
+    else {
+      Consumers.push_back(
+        std::unique_ptr<ASTConsumer>(CurrentTransformationImpl));
+    }
+    ClangInstance->setASTConsumer(std::unique_ptr<ASTConsumer>(
+      new MultiplexConsumer(std::move(Consumers))));
+  }
+  else {
+    ClangInstance->setASTConsumer(
+      std::unique_ptr<ASTConsumer>(CurrentTransformationImpl));
+  }
   Preprocessor &PP = ClangInstance->getPreprocessor();
   PP.getBuiltinInfo().initializeBuiltins(PP.getIdentifierTable(),
                                          PP.getLangOpts());
@@ -203,8 +329,11 @@ void TransformationManager::Finalize()
   for (I = Instance->TransformationsMap.begin(), 
        E = Instance->TransformationsMap.end();
        I != E; ++I) {
-    // CurrentTransformationImpl will be freed by ClangInstance
-    if ((*I).second != Instance->CurrentTransformationImpl)
+    // CurrentTransformationImpl and the queried transformations will be
+    // freed by ClangInstance, unless the source was only lexed
+    if (Instance->TokenOnly ||
+        ((*I).second != Instance->CurrentTransformationImpl &&
+         !Instance->isQueryTransformation((*I).second)))
       delete (*I).second;
   }
   if (Instance->TransformationsMapPtr)
@@ -238,13 +367,18 @@ bool TransformationManager::doTransformation(std::string &ErrorMsg, int &ErrorCo
 {
   ErrorMsg = "";
 
-  ClangInstance->createSema(TU_Complete, 0);
+  if (!TokenOnly)
+    ClangInstance->createSema(TU_Complete, 0);
   DiagnosticsEngine &Diag = ClangInstance->getDiagnostics();
   Diag.setSuppressAllDiagnostics(true);
   Diag.setIgnoreAllWarnings(true);
 
   CurrentTransformationImpl->setQueryInstanceFlag(QueryInstanceOnly);
   CurrentTransformationImpl->setTransformationCounter(TransformationCounter);
+  for (auto &QT : QueryTransformations) {
+    QT.second->setQueryInstanceFlag(true);
+    QT.second->setTransformationCounter(TransformationCounter);
+  }
   if (ToCounter > 0) {
     if (CurrentTransformationImpl->isMultipleRewritesEnabled()) {
       CurrentTransformationImpl->setToCounter(ToCounter);
@@ -257,9 +391,20 @@ bool TransformationManager::doTransformation(std::string &ErrorMsg, int &ErrorCo
     }
   }
 
-  ParseAST(ClangInstance->getSema());
+  if (TokenOnly) {
+    if (QueryTransformations.size() > 1) {
+      for (auto &QT : QueryTransformations)
+        QT.second->HandleTokens();
+    }
+    else {
+      CurrentTransformationImpl->HandleTokens();
+    }
+  }
+  else {
+    ParseAST(ClangInstance->getSema());
 
-  ClangInstance->getDiagnosticClient().EndSourceFile();
+    ClangInstance->getDiagnosticClient().EndSourceFile();
+  }
 
   if (QueryInstanceOnly) {
     return true;
@@ -349,8 +494,41 @@ void TransformationManager::printTransformationNames()
   }
 }
 
+// Whether the transformation, or all of the queried ones, can do without
+// Sema.
+bool TransformationManager::isTokenOnlyRun()
+{
+  if (QueryTransformations.size() <= 1)
+    return CurrentTransformationImpl->isTokenOnly();
+  for (auto &QT : QueryTransformations) {
+    if (!QT.second->isTokenOnly())
+      return false;
+  }
+  return true;
+}
+
+bool TransformationManager::isQueryTransformation(Transformation *Trans)
+{
+  if (QueryTransformations.size() <= 1)
+    return false;
+  for (auto &QT : QueryTransformations) {
+    if (QT.second == Trans)
+      return true;
+  }
+  return false;
+}
+
 void TransformationManager::outputNumTransformationInstances()
 {
+  if (QueryTransformations.size() > 1) {
+    for (auto &QT : QueryTransformations) {
+      llvm::outs() << "Available transformation instances of " << QT.first
+                   << ": " << QT.second->getNumTransformationInstances()
+                   << "\n";
+    }
+    return;
+  }
+
   int NumInstances = 
     CurrentTransformationImpl->getNumTransformationInstances();
   llvm::outs() << "Available transformation instances: " 
@@ -366,10 +544,15 @@ TransformationManager::TransformationManager()
     CurrentTransName(""),
     ClangInstance(NULL),
     QueryInstanceOnly(false),
+    TokenOnly(false),
     DoReplacement(false),
     Replacement(""),
     CheckReference(false),
-    ReferenceValue("")
+    ReferenceValue(""),
+    CoverageFileName(""),
+    MaxErrors(0),
+    MaxInstantiationDepth(0),
+    TimeLimit(0)
 {
   // Nothing to do
 }
@@ -13,6 +13,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <cassert>
 
 #include "llvm/Support/raw_ostream.h"
@@ -44,6 +45,8 @@ public:
 
   static int ErrorInvalidCounter;
 
+  static int ErrorGaveUp;
+
   bool doTransformation(std::string &ErrorMsg, int &ErrorCode);
 
   bool verify(std::string &ErrorMsg, int &ErrorCode);
@@ -56,6 +59,18 @@ public:
     return 0;
   }
 
+  int addQueryTransformation(const std::string &Trans) {
+    if (setTransformation(Trans))
+      return -1;
+    for (auto &QT : QueryTransformations) {
+      if (QT.first == Trans)
+        return 0;
+    }
+    QueryTransformations.push_back(
+      std::make_pair(Trans, CurrentTransformationImpl));
+    return 0;
+  }
+
   void setTransformationCounter(int Counter) {
     assert((Counter > 0) && "Bad Counter value!");
     TransformationCounter = Counter;
@@ -85,6 +100,22 @@ public:
     CheckReference = true;
   }
 
+  void setCoverageFileName(const std::string &FileName) {
+    CoverageFileName = FileName;
+  }
+
+  void setMaxErrors(int Num) {
+    MaxErrors = Num;
+  }
+
+  void setMaxInstantiationDepth(int Depth) {
+    MaxInstantiationDepth = Depth;
+  }
+
+  void setTimeLimit(int Seconds) {
+    TimeLimit = Seconds;
+  }
+
   void setQueryInstanceFlag(bool Flag) {
     QueryInstanceOnly = Flag;
   }
@@ -111,6 +142,10 @@ private:
 
   void closeOutStream(llvm::raw_ostream *OutStream);
 
+  bool isQueryTransformation(Transformation *Trans);
+
+  bool isTokenOnlyRun();
+
   static TransformationManager *Instance;
 
   static std::map<std::string, Transformation *> *TransformationsMapPtr;
@@ -133,6 +168,14 @@ private:
 
   bool QueryInstanceOnly;
 
+  // Transformations whose instances are counted together on a single
+  // parse of the source (--query-instances=<name1>,<name2>,...)
+  std::vector<std::pair<std::string, Transformation *> > QueryTransformations;
+
+  // Whether all of the transformations of this run are token-only, so
+  // that the source is raw-lexed instead of being preprocessed and parsed
+  bool TokenOnly;
+
   bool DoReplacement;
 
   std::string Replacement;
@@ -141,6 +184,17 @@ private:
 
   std::string ReferenceValue;
 
+  // gcov output for the source (--coverage)
+  std::string CoverageFileName;
+
+  // Budgets for pathological inputs; clang_delta exits with ErrorGaveUp
+  // once one of them is exceeded. Zero means no limit.
+  int MaxErrors;
+
+  int MaxInstantiationDepth;
+
+  int TimeLimit;
+
   // Unimplemented
   TransformationManager(const TransformationManager &);
 
@@ -0,0 +1,18 @@
+// RUN: %clang_delta --transformation=fold-constant-expr --counter=1 --to-counter=5 %s 2>&1 | %remove_lit_checks | FileCheck %s
+
+// CHECK: enum E { A = 3, B = 12 };
+enum E { A = 3, B = A * 4 };
+struct S { int a; char b[10]; };
+
+// CHECK: int x = 15;
+int x = A + B;
+// CHECK: unsigned long y = 16UL;
+unsigned long y = sizeof(struct S);
+// CHECK: int z = 1 << 20;
+int z = 1 << 20;
+void foo(int p) {
+// CHECK: int a = p + (-16);
+  int a = p + -(2 * 8);
+// CHECK: double d = 1.5;
+  double d = 3.0 / 2.0;
+}
@@ -0,0 +1,16 @@
+// RUN: %clang_delta --transformation=fold-constant-expr --counter=1 --to-counter=3 %s 2>&1 | %remove_lit_checks | FileCheck %s
+
+#define SIZE (4 * 8)
+#define TWICE(x) (x) * 2
+#define ID(x) x
+
+void foo(int p) {
+// CHECK: int a = 32;
+  int a = SIZE;
+// CHECK: int b = 6 + p;
+  int b = TWICE(1 + 2) + p;
+// CHECK: int c = TWICE(p);
+  int c = TWICE(p);
+// CHECK: int d = 7;
+  int d = ID(3 + 4);
+}
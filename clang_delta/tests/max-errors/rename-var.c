@@ -0,0 +1,11 @@
+// RUN: %clang_delta --transformation=rename-var --counter=1 --max-errors=10 %s 2>&1 | %remove_lit_checks | FileCheck %s
+// RUN: not %clang_delta --transformation=rename-var --counter=1 --max-errors=1 %s
+
+// A variant with a few errors is transformed as it is without a budget
+
+// CHECK: int a;
+int abcdef;
+// CHECK: int f(void) { return a + undeclared1; }
+int f(void) { return abcdef + undeclared1; }
+// CHECK: int g(void) { return undeclared2; }
+int g(void) { return undeclared2; }
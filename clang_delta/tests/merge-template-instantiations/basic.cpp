@@ -0,0 +1,29 @@
+// RUN: %clang_delta --transformation=merge-template-instantiations --counter=1 %s 2>&1 | %remove_lit_checks | FileCheck %s
+
+template <typename T> struct Small {
+  T Val;
+};
+
+template <typename T> struct Big {
+  T Vals[4];
+  T sum() {
+    T S = 0;
+    for (int I = 0; I < 4; ++I)
+      S += Vals[I];
+    return S;
+  }
+};
+
+// CHECK: Small<int> S1;
+Small<int> S1;
+// CHECK: Small<char> S2;
+Small<char> S2;
+// CHECK: Big<int> B1;
+Big<int> B1;
+// CHECK: Big<int> B2;
+Big<int> B2;
+// CHECK: Big<int> B3;
+Big<long> B3;
+
+// CHECK: long f() { return B1.sum() + B3.sum(); }
+long f() { return B1.sum() + B3.sum(); }
@@ -0,0 +1,16 @@
+// RUN: %clang_delta --query-instances=return-void,remove-unused-var,rename-fun %s 2>&1 | FileCheck %s
+// RUN: %clang_delta --query-instances=return-void %s 2>&1 | FileCheck --check-prefix=SINGLE %s
+
+// CHECK: Available transformation instances of return-void: 2
+// CHECK: Available transformation instances of remove-unused-var: 1
+// CHECK: Available transformation instances of rename-fun: {{[0-9]+}}
+// SINGLE: Available transformation instances: 2
+
+int *foo(void) {
+  int unused;
+  return 0;
+}
+
+char *bar(int i) {
+  return 0;
+}
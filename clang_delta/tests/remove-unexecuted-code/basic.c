@@ -0,0 +1,38 @@
+// RUN: %clang_delta --transformation=remove-unexecuted-code --coverage=%S/basic.c.gcov --counter=1 --to-counter=4 %s 2>&1 | %remove_lit_checks | FileCheck %s
+
+int g;
+
+// CHECK: int never(int x) {}
+int never(int x) {
+  g = x;
+  return x + 1;
+}
+
+// CHECK: int sometimes(int x) {
+int sometimes(int x) {
+// CHECK-NEXT: if (x > 0) ;
+  if (x > 0) {
+    g = 2;
+  }
+// CHECK-NEXT: else {
+// CHECK-NEXT: g = 3;
+  else {
+    g = 3;
+  }
+// CHECK: while (x > 10)
+// CHECK-NEXT: {{^ *;$}}
+  while (x > 10)
+    x--;
+// CHECK-NEXT: if (x == 7)
+// CHECK-NEXT: {{^ *;$}}
+  if (x == 7)
+    return 0;
+// CHECK-NEXT: g += x;
+  g += x;
+  return g;
+}
+
+// CHECK: int main(void) {
+int main(void) {
+  return sometimes(-1) != 2;
+}
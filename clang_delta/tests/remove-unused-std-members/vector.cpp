@@ -0,0 +1,39 @@
+// RUN: %clang_delta --transformation=remove-unused-std-members --counter=1 %s 2>&1 | %remove_lit_checks | FileCheck %s
+
+namespace std {
+template <typename T> class vector {
+  T *Data;
+  unsigned Size;
+public:
+// CHECK: vector() : Data(0), Size(0) {}
+  vector() : Data(0), Size(0) {}
+// CHECK-NOT: vector(unsigned N)
+  vector(unsigned N) : Data(new T[N]), Size(N) {}
+// CHECK: ~vector() { delete[] Data; }
+  ~vector() { delete[] Data; }
+// CHECK: unsigned size() const { return Size; }
+  unsigned size() const { return Size; }
+// CHECK-NOT: bool empty
+  bool empty() const { return Size == 0; }
+// CHECK-NOT: T &at
+  T &at(unsigned I);
+// CHECK-NOT: assign
+  template <typename It> void assign(It B, It E) { }
+// CHECK: template <typename U> void push(U V) { grow(); }
+  template <typename U> void push(U V) { grow(); }
+// CHECK: void grow();
+  void grow();
+};
+
+// CHECK-NOT: ::at
+template <typename T> T &vector<T>::at(unsigned I) { return Data[I]; }
+// CHECK: template <typename T> void vector<T>::grow() { }
+template <typename T> void vector<T>::grow() { }
+}
+
+// CHECK: int f() {
+int f() {
+  std::vector<int> V;
+  V.push(1);
+  return V.size();
+}
@@ -0,0 +1,28 @@
+// RUN: %clang_delta --transformation=rename-tokens --counter=2 %s 2>&1 | %remove_lit_checks | FileCheck %s
+// RUN: %clang_delta --query-instances=rename-tokens %s 2>&1 | FileCheck --check-prefix=QUERY %s
+
+// QUERY: Available transformation instances: 8
+
+// CHECK: #include <string.h>
+#include <string.h>
+
+// CHECK: #define LEN 4
+#define LEN 4
+
+// CHECK: struct a { int x, y; };
+struct point { int x, y; };
+
+// the missing semicolon does not get in the way
+// CHECK: int count(struct a *p) {
+int count(struct point *p) {
+// CHECK-NEXT: return p->x + LEN
+  return p->x + LEN
+}
+
+// CHECK: int main() {
+int main() {
+// CHECK-NEXT: struct a pt;
+  struct point pt;
+  memset(&pt, 0, sizeof pt);
+  return count(&pt);
+}
@@ -35,6 +35,12 @@ enum tok_kind {
 };
 
 void process_token(enum tok_kind);
+void process_token_text(char *, enum tok_kind);
+
+/*
+ * Stuff defined in `tokenizer.c'.
+ */
+void tokenize_with_rules(const char *rules, FILE *in);
 
 #define OK 51
 #define STOP 71
@@ -45,7 +45,11 @@ static int add_tok(char *str, enum tok_kind kind) {
 }
 
 void process_token(enum tok_kind kind) {
-  int tok = add_tok(yytext, kind);
+  process_token_text(yytext, kind);
+}
+
+void process_token_text(char *text, enum tok_kind kind) {
+  int tok = add_tok(text, kind);
   count++;
 }
 
@@ -294,11 +298,114 @@ static void delete_string(int idx) {
 
 static int n_toks;
 
+/*
+ * In balanced mode, the token deletion commands skip any window that would
+ * delete one bracket of a matching pair but not the other, and tell the
+ * caller on stderr which index they used instead.  Deleting whole pairs
+ * from a file whose brackets match leaves them matching.
+ */
+static int balanced;
+
+static int *sig;     /* tok_list indices of the non-whitespace tokens */
+static int n_sig;
+static int *partner; /* tok_list index of the matching bracket, or -1 */
+static char *doomed;
+
+static void find_significant(void) {
+  int i;
+  sig = (int *)malloc((toks + 1) * sizeof(int));
+  assert(sig);
+  n_sig = 0;
+  for (i = 0; i < toks; i++) {
+    if (tok_list[i].kind != TOK_WS &&
+        tok_list[i].kind != TOK_NEWLINE)
+      sig[n_sig++] = i;
+  }
+}
+
+static char closer(const char *str) {
+  if (strcmp(str, "(") == 0)
+    return ')';
+  if (strcmp(str, "[") == 0)
+    return ']';
+  if (strcmp(str, "{") == 0)
+    return '}';
+  return 0;
+}
+
+static int is_closer(const char *str) {
+  return strcmp(str, ")") == 0 || strcmp(str, "]") == 0 ||
+         strcmp(str, "}") == 0;
+}
+
+/*
+ * Pairs up brackets with a stack; a bracket that does not match anything
+ * is left unconstrained.
+ */
+static void match_brackets(void) {
+  int *stack = (int *)malloc((toks + 1) * sizeof(int));
+  int depth = 0;
+  int i;
+  partner = (int *)malloc((toks + 1) * sizeof(int));
+  doomed = (char *)calloc(toks + 1, 1);
+  assert(stack && partner && doomed);
+  for (i = 0; i < toks; i++) {
+    partner[i] = -1;
+    if (tok_list[i].kind != TOK_OP && tok_list[i].kind != TOK_UNKNOWN)
+      continue;
+    if (closer(tok_list[i].str)) {
+      stack[depth++] = i;
+    } else if (is_closer(tok_list[i].str)) {
+      int d = depth;
+      while (d > 0 && closer(tok_list[stack[d - 1]].str) != tok_list[i].str[0])
+        d--;
+      if (d == 0)
+        continue;
+      depth = d - 1;
+      partner[i] = stack[depth];
+      partner[stack[depth]] = i;
+    }
+  }
+  free(stack);
+}
+
+static int keeps_pairs(const int *del, int n) {
+  int i;
+  int ok = 1;
+  for (i = 0; i < n; i++)
+    doomed[del[i]] = 1;
+  for (i = 0; i < n; i++) {
+    int p = partner[del[i]];
+    if (p != -1 && !doomed[p])
+      ok = 0;
+  }
+  for (i = 0; i < n; i++)
+    doomed[del[i]] = 0;
+  return ok;
+}
+
+static void report_index(int idx) {
+  fprintf(stderr, "index %d\n", idx);
+}
+
 static void rm_toks(int idx) {
   int i;
   int matched = 0;
   int which = 0;
   int started = 0;
+  if (balanced) {
+    find_significant();
+    match_brackets();
+    while (idx < n_sig) {
+      int n = n_sig - idx < n_toks ? n_sig - idx : n_toks;
+      if (keeps_pairs(&sig[idx], n))
+        break;
+      idx++;
+    }
+    if (idx >= n_sig)
+      exit(STOP);
+    report_index(idx);
+  }
   for (i = 0; i < toks; i++) {
     if (tok_list[i].kind != TOK_WS &&
         tok_list[i].kind != TOK_NEWLINE) {
@@ -327,10 +434,42 @@ static void print_pattern(unsigned char c) {
   printf("\n");
 }
 
+/*
+ * The window of `rm-tok-pattern' index `idx', as tok_list indices of the
+ * tokens it deletes; returns how many there are, or -1 if the window starts
+ * past the last token.
+ */
+static int pattern_deletes(int idx, int *del) {
+  int n_patterns = 1 << (n_toks - 1);
+  unsigned pat = 1 | ((unsigned)(idx & (n_patterns - 1)) << 1);
+  int pos = idx >> (n_toks - 1);
+  int n = 0;
+  int k;
+  if (pos >= n_sig)
+    return -1;
+  for (k = 0; k < n_toks && pos + k < n_sig; k++) {
+    if (pat & (1u << k))
+      del[n++] = sig[pos + k];
+  }
+  return n;
+}
+
 static void rm_tok_pattern(int idx) {
   int i;
   int n_patterns = 1 << (n_toks - 1);
 
+  if (balanced) {
+    int del[8];
+    int n;
+    find_significant();
+    match_brackets();
+    while ((n = pattern_deletes(idx, del)) >= 0 && !keeps_pairs(del, n))
+      idx++;
+    if (n < 0)
+      exit(STOP);
+    report_index(idx);
+  }
+
 #ifdef _MSC_VER
   unsigned char *patterns = calloc(n_patterns, sizeof(unsigned char));
 #else
@@ -458,8 +597,22 @@ void define(int tok_index) {
 }
 
 int main(int argc, char *argv[]) {
+  char *prog = argv[0];
+  char *rules = 0;
+  while (argc > 4 && strncmp(argv[1], "--", 2) == 0) {
+    if (strncmp(argv[1], "--tokenizer=", 12) == 0) {
+      rules = &argv[1][12];
+    } else if (strcmp(argv[1], "--balanced") == 0) {
+      balanced = 1;
+    } else {
+      break;
+    }
+    argv++;
+    argc--;
+  }
   if (argc != 4) {
-    printf("USAGE: %s command index file\n", argv[0]);
+    printf("USAGE: %s [--tokenizer=rules] [--balanced] command index file\n",
+           prog);
     exit(STOP);
   }
 
@@ -504,7 +657,10 @@ int main(int argc, char *argv[]) {
   tok_list = (struct tok_t *)malloc(max_toks * sizeof(struct tok_t));
   assert(tok_list);
 
-  yylex();
+  if (rules)
+    tokenize_with_rules(rules, in);
+  else
+    yylex();
 
   // these calls all exit() at the end
   switch (mode) {
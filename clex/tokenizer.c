@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2013, 2014, 2015, 2016 The University of Utah
+ * All rights reserved.
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License.  See the file COPYING for details.
+ */
+
+/*
+ * A table-driven scanner for languages other than C.  The lexical rules are
+ * read at run time from a small rule file, one directive per line:
+ *
+ *   ident-start   <chars>          characters that may begin an identifier
+ *   ident-char    <chars>          characters that may continue one
+ *   number-start  <chars>          characters that may begin a number
+ *   number-char   <chars>          characters that may continue one
+ *   line-comment  <open>           comment running to the end of the line
+ *   block-comment <open> <close>   delimited comment
+ *   string        <quote> [<esc>]  string literal with optional escape char
+ *   op            <text> ...       operators and punctuators
+ *   keyword       <word> ...       identifiers that are really keywords
+ *
+ * Blank lines and lines starting with '#' are ignored.  Character sets may
+ * contain ranges such as "a-z"; a literal '-' must come first or last.
+ * Comments are dropped and everything else is handed to the same token list
+ * that the flex scanner feeds, so every clex command works unchanged.
+ *
+ * The rules are compiled into a 256-entry character class table, with
+ * comment openers, string quotes and operators bucketed by their first byte
+ * and sorted longest-first, so scanning costs one table lookup per character
+ * plus a short maximal-munch scan of the bucket.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+
+enum {
+  CC_IDENT_START = 1,
+  CC_IDENT_CHAR = 2,
+  CC_NUMBER_START = 4,
+  CC_NUMBER_CHAR = 8,
+};
+
+enum lexeme_kind {
+  LX_LINE_COMMENT,
+  LX_BLOCK_COMMENT,
+  LX_STRING,
+  LX_OP,
+};
+
+struct lexeme_t {
+  enum lexeme_kind kind;
+  char *open;
+  size_t open_len;
+  char *close;     /* comment terminator or string quote */
+  size_t close_len;
+  int escape;      /* string escape character as unsigned char, or -1 */
+};
+
+static unsigned char char_class[256];
+static struct lexeme_t *lexemes[256];
+static int n_lexemes[256];
+static char **keywords;
+static int n_keywords;
+
+static void rule_error(const char *file, int line, const char *msg) {
+  fprintf(stderr, "%s:%d: %s\n", file, line, msg);
+  exit(STOP);
+}
+
+static void add_char_set(unsigned char bit, const char *set) {
+  size_t len = strlen(set);
+  size_t i;
+  for (i = 0; i < len; i++) {
+    unsigned char lo = set[i];
+    unsigned char hi = lo;
+    if (i + 2 < len && set[i + 1] == '-') {
+      hi = set[i + 2];
+      i += 2;
+    }
+    unsigned c;
+    for (c = lo; c <= hi; c++)
+      char_class[c] |= bit;
+  }
+}
+
+static void add_lexeme(enum lexeme_kind kind, const char *open,
+                       const char *close, int escape) {
+  unsigned char first = open[0];
+  struct lexeme_t *l;
+  lexemes[first] = (struct lexeme_t *)realloc(
+      lexemes[first], (n_lexemes[first] + 1) * sizeof(struct lexeme_t));
+  assert(lexemes[first]);
+  l = &lexemes[first][n_lexemes[first]++];
+  l->kind = kind;
+  l->open = strdup(open);
+  assert(l->open);
+  l->open_len = strlen(open);
+  l->close = close ? strdup(close) : 0;
+  l->close_len = close ? strlen(close) : 0;
+  l->escape = escape;
+}
+
+static int longest_first(const void *a, const void *b) {
+  const struct lexeme_t *x = (const struct lexeme_t *)a;
+  const struct lexeme_t *y = (const struct lexeme_t *)b;
+  if (x->open_len != y->open_len)
+    return x->open_len < y->open_len ? 1 : -1;
+  return 0;
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void read_rules(const char *file) {
+  FILE *f = fopen(file, "r");
+  if (!f) {
+    fprintf(stderr, "cannot open tokenizer rules '%s'\n", file);
+    exit(STOP);
+  }
+  char buf[1024];
+  int line = 0;
+  while (fgets(buf, sizeof(buf), f)) {
+    line++;
+    char *words[64];
+    int n = 0;
+    char *w = strtok(buf, " \t\r\n");
+    if (!w || w[0] == '#')
+      continue;
+    while (w && n < 64) {
+      words[n++] = w;
+      w = strtok(0, " \t\r\n");
+    }
+    const char *dir = words[0];
+    int i;
+    if (n < 2)
+      rule_error(file, line, "directive without arguments");
+    if (strcmp(dir, "ident-start") == 0) {
+      for (i = 1; i < n; i++)
+        add_char_set(CC_IDENT_START, words[i]);
+    } else if (strcmp(dir, "ident-char") == 0) {
+      for (i = 1; i < n; i++)
+        add_char_set(CC_IDENT_CHAR, words[i]);
+    } else if (strcmp(dir, "number-start") == 0) {
+      for (i = 1; i < n; i++)
+        add_char_set(CC_NUMBER_START, words[i]);
+    } else if (strcmp(dir, "number-char") == 0) {
+      for (i = 1; i < n; i++)
+        add_char_set(CC_NUMBER_CHAR, words[i]);
+    } else if (strcmp(dir, "line-comment") == 0) {
+      for (i = 1; i < n; i++)
+        add_lexeme(LX_LINE_COMMENT, words[i], 0, -1);
+    } else if (strcmp(dir, "block-comment") == 0) {
+      if (n != 3)
+        rule_error(file, line, "block-comment needs <open> <close>");
+      add_lexeme(LX_BLOCK_COMMENT, words[1], words[2], -1);
+    } else if (strcmp(dir, "string") == 0) {
+      if (n > 3 || strlen(words[1]) != 1 || (n == 3 && strlen(words[2]) != 1))
+        rule_error(file, line, "string needs a one-character quote and escape");
+      add_lexeme(LX_STRING, words[1], words[1],
+                 n == 3 ? (unsigned char)words[2][0] : -1);
+    } else if (strcmp(dir, "op") == 0) {
+      for (i = 1; i < n; i++)
+        add_lexeme(LX_OP, words[i], 0, -1);
+    } else if (strcmp(dir, "keyword") == 0) {
+      keywords = (char **)realloc(keywords,
+                                  (n_keywords + n - 1) * sizeof(char *));
+      assert(keywords);
+      for (i = 1; i < n; i++) {
+        keywords[n_keywords] = strdup(words[i]);
+        assert(keywords[n_keywords]);
+        n_keywords++;
+      }
+    } else {
+      rule_error(file, line, "unknown directive");
+    }
+  }
+  fclose(f);
+
+  int c;
+  for (c = 0; c < 256; c++) {
+    if (n_lexemes[c] > 1)
+      qsort(lexemes[c], n_lexemes[c], sizeof(struct lexeme_t), longest_first);
+  }
+  if (n_keywords > 1)
+    qsort(keywords, n_keywords, sizeof(char *), compare_strings);
+}
+
+static char *read_input(FILE *in, size_t *len) {
+  size_t cap = 4096;
+  size_t n = 0;
+  char *buf = (char *)malloc(cap);
+  assert(buf);
+  size_t got;
+  while ((got = fread(buf + n, 1, cap - n - 1, in)) > 0) {
+    n += got;
+    if (cap - n - 1 == 0) {
+      cap *= 2;
+      buf = (char *)realloc(buf, cap);
+      assert(buf);
+    }
+  }
+  buf[n] = 0;
+  *len = n;
+  return buf;
+}
+
+static void emit(char *start, char *end, enum tok_kind kind) {
+  char saved = *end;
+  *end = 0;
+  process_token_text(start, kind);
+  *end = saved;
+}
+
+static int is_keyword(char *start, char *end) {
+  if (n_keywords == 0)
+    return 0;
+  char saved = *end;
+  *end = 0;
+  char *key = start;
+  int found = bsearch(&key, keywords, n_keywords, sizeof(char *),
+                      compare_strings) != 0;
+  *end = saved;
+  return found;
+}
+
+/*
+ * Returns the end of the lexeme starting at `p', or 0 if it is a string
+ * that is not terminated.
+ */
+static char *scan_lexeme(const struct lexeme_t *l, char *p, char *limit) {
+  char *q = p + l->open_len;
+  switch (l->kind) {
+  case LX_OP:
+    return q;
+  case LX_LINE_COMMENT:
+    while (q < limit && *q != '\n')
+      q++;
+    return q;
+  case LX_BLOCK_COMMENT:
+    while (q + l->close_len <= limit) {
+      if (memcmp(q, l->close, l->close_len) == 0)
+        return q + l->close_len;
+      q++;
+    }
+    /* same as the flex scanner: an unterminated comment is not C-Reduce's
+       problem to fix */
+    exit(STOP);
+  case LX_STRING:
+    while (q < limit) {
+      if ((unsigned char)*q == l->escape && q + 1 < limit) {
+        q += 2;
+        continue;
+      }
+      if (*q == l->close[0])
+        return q + 1;
+      if (*q == '\n')
+        return 0;
+      q++;
+    }
+    return 0;
+  }
+  assert(0);
+  return 0;
+}
+
+void tokenize_with_rules(const char *rules, FILE *in) {
+  read_rules(rules);
+
+  size_t len;
+  char *buf = read_input(in, &len);
+  char *p = buf;
+  char *limit = buf + len;
+
+  while (p < limit) {
+    unsigned char c = *p;
+    unsigned char cls = char_class[c];
+
+    if (c == '\n') {
+      emit(p, p + 1, TOK_NEWLINE);
+      p++;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\v' || c == '\f') {
+      emit(p, p + 1, TOK_WS);
+      p++;
+      continue;
+    }
+
+    /* comments, strings and operators: maximal munch within the bucket */
+    struct lexeme_t *match = 0;
+    char *end = 0;
+    int i;
+    for (i = 0; i < n_lexemes[c]; i++) {
+      struct lexeme_t *l = &lexemes[c][i];
+      if (l->open_len > (size_t)(limit - p) ||
+          memcmp(p, l->open, l->open_len) != 0)
+        continue;
+      char *e = scan_lexeme(l, p, limit);
+      if (e && (!end || e > end)) {
+        match = l;
+        end = e;
+      }
+    }
+
+    /* an identifier or number wins over an operator it strictly extends,
+       so that e.g. "op -" does not split "-1" when '-' starts numbers */
+    if (cls & (CC_IDENT_START | CC_NUMBER_START)) {
+      unsigned char cont =
+          (cls & CC_IDENT_START) ? CC_IDENT_CHAR | CC_IDENT_START
+                                 : CC_NUMBER_CHAR | CC_NUMBER_START;
+      char *q = p + 1;
+      while (q < limit && (char_class[(unsigned char)*q] & cont))
+        q++;
+      if (!match || (match->kind == LX_OP && q > end)) {
+        enum tok_kind kind;
+        if (cls & CC_IDENT_START)
+          kind = is_keyword(p, q) ? TOK_KEYWORD : TOK_IDENT;
+        else
+          kind = TOK_NUMBER;
+        emit(p, q, kind);
+        p = q;
+        continue;
+      }
+    }
+
+    if (match) {
+      switch (match->kind) {
+      case LX_LINE_COMMENT:
+      case LX_BLOCK_COMMENT:
+        break;
+      case LX_STRING:
+        emit(p, end, TOK_STRING);
+        break;
+      case LX_OP:
+        emit(p, end, TOK_OP);
+        break;
+      }
+      p = end;
+      continue;
+    }
+
+    emit(p, p + 1, TOK_UNKNOWN);
+    p++;
+  }
+  free(buf);
+}
@@ -12,20 +12,59 @@ package creduce_utils;
 
 use warnings;
 
+use Digest::MD5 qw(md5_hex);
 use Exporter::Lite;
 use File::Spec;
+use File::Temp;
 use File::Which;
+use IPC::Open2;
 
-@EXPORT      = qw($DEBUG $OK $STOP $ERROR
+@EXPORT      = qw($DEBUG $TOKENIZER $BALANCED_TOKENS $ORDER_BY_HISTORY $PUT_ASIDE $OK $STOP $ERROR
+		  $COVERAGE_CC
 		  find_external_program
-		  runit nprocs
-                  run_clang_delta
+		  runit ncpus nprocs
+                  run_clang_delta clang_delta_limits
+		  $CLANG_DELTA_SERVERS use_clang_delta start_clang_delta_servers
+		  clang_delta_servers clang_delta_server_exited clang_delta_output
+		  run_clang_delta_batch
+		  $CLANG_MAX_ERRORS $CLANG_MAX_DEPTH $CLANG_TIME_LIMIT
+		  instances_key cached_instances cache_instances
+		  forget_instances export_instances import_instances
+		  $FOCUS focus_init focus_line
+		  change_made
 		  $replace_cont $matched replace_aux
 		  read_file write_file
                   );
 
 $DEBUG = 0;
 
+# Rule file for `clex', used in place of its built-in C scanner if defined.
+$TOKENIZER = undef;
+
+# Whether `clex' skips token deletions that would leave a bracket without
+# its partner.
+$BALANCED_TOKENS = 1;
+
+# How pass_clang orders candidates by the outcomes of earlier ones:
+# 0 = counter order; 1 = candidates resembling earlier failures are put
+# aside and skipped, and counted in $PUT_ASIDE; 2 = they are put aside
+# and tried last.
+$ORDER_BY_HISTORY = 0;
+$PUT_ASIDE = 0;
+
+# Compiler command that pass_coverage builds an instrumented copy of the
+# program with; the pass does nothing unless this is defined.
+$COVERAGE_CC = undef;
+
+# Whether the clang_delta passes run clang_delta through warm
+# `clang_delta --server' processes, one for each test slot.
+$CLANG_DELTA_SERVERS = 0;
+
+# Budgets passed on to clang_delta; undefined means no limit.
+$CLANG_MAX_ERRORS = undef;
+$CLANG_MAX_DEPTH = undef;
+$CLANG_TIME_LIMIT = undef;
+
 $OK = 999999;
 $STOP = 111333;
 $ERROR = 223334;
@@ -51,23 +90,270 @@ sub runit ($) {
     return $? >> 8;
 }
 
+sub clang_delta_result ($) {
+    (my $res) = @_;
+    if ($res == 255) {
+        return -1;
+    }
+    elsif ($res == 1) {
+        return -2;
+    }
+    elsif ($res == 2) {
+        # clang_delta gave up on this input (see clang_delta_limits)
+        return -4;
+    }
+    elsif ($res != 0) {
+        return -3;
+    }
+    return 0;
+}
+
 sub run_clang_delta ($) {
     (my $cmd) = @_;
     if ((system "$cmd") != 0) {
-        my $res = $? >> 8;
-        if ($res == 255) {
-            return -1;
-        }
-        elsif ($res == 1) {
-            return -2;
-        }
-        else {
-            return -3;
-        }
+        # a crash is -3 too
+        return -3 if ($? & 127);
+        return clang_delta_result ($? >> 8);
     }
     return ($? >> 8);
 }
 
+# the warm clang_delta processes: [pid, to, from] each, started by the
+# driver once the prereqs are checked and kept for the whole run; a
+# transform that runs in a child process (see --transform-budget) uses
+# them too, and if it is killed while waiting, its answer is left
+# behind, so each request carries an id and answers to other ids are
+# skipped
+
+my $clang_delta_program;
+my @servers;
+my $requests = 0;
+
+# the servers write into this directory, which goes away with the driver,
+# so that what they make for a transform that gets killed goes too
+my $server_dir;
+my $outputs = 0;
+
+# called by the clang_delta passes once they have found clang_delta
+sub use_clang_delta ($) {
+    ($clang_delta_program) = @_;
+}
+
+sub start_clang_delta_servers ($) {
+    (my $n) = @_;
+    return if (@servers || !defined($clang_delta_program) || $^O eq "MSWin32");
+    my $clang_delta = $clang_delta_program;
+    $server_dir = File::Temp::tempdir ("creduce-servers-XXXXXX", TMPDIR => 1,
+				       CLEANUP => 1);
+    for (my $i = 0; $i < $n; $i++) {
+	my ($from, $to);
+	my $pid = eval { open2 ($from, $to, $clang_delta, "--server") };
+	last unless defined $pid;
+	push @servers, [$pid, $to, $from];
+    }
+    print "started " . scalar(@servers) . " clang_delta servers\n" if $DEBUG;
+}
+
+sub clang_delta_servers () {
+    return scalar(@servers);
+}
+
+# a new file for clang_delta to write a variant to
+sub clang_delta_output () {
+    return scalar(File::Temp::tmpnam()) unless defined $server_dir;
+    return File::Spec->catfile ($server_dir, "$$." . $outputs++);
+}
+
+# for the driver, when it reaps a child process that it did not start
+# itself: whether it was one of the servers, which is then dropped
+sub clang_delta_server_exited ($) {
+    (my $pid) = @_;
+    my $n = scalar(@servers);
+    @servers = grep { ${$_}[0] != $pid } @servers;
+    return ($n != scalar(@servers));
+}
+
+# runs clang_delta with each of the given argument lists, writing its
+# output to the file that goes with them, as many at a time as there are
+# servers (or one at a time, without servers), and returns what
+# run_clang_delta would have for each
+sub run_clang_delta_batch ($$) {
+    (my $clang_delta, my $jobs) = @_;
+    my @res = ();
+    local $SIG{PIPE} = 'IGNORE';
+    for (my $first = 0; $first < scalar(@{$jobs}); ) {
+	my @sent = ();
+	foreach my $server (@servers) {
+	    last if ($first + scalar(@sent) >= scalar(@{$jobs}));
+	    (my $args, my $out) = @{${$jobs}[$first + scalar(@sent)]};
+	    my $id = "$$." . $requests++;
+	    my $req = join ("\t", $id, $out, @{$args}) . "\n";
+	    print "clang_delta server ${$server}[0]: $req" if $DEBUG;
+	    my $n = syswrite (${$server}[1], $req);
+	    if (!defined($n) || $n != length($req)) {
+		${$server}[0] = -1;
+		next;
+	    }
+	    push @sent, [$server, $id];
+	}
+	@servers = grep { ${$_}[0] != -1 } @servers;
+	if (!@sent) {
+	    # no servers, or none that work
+	    (my $args, my $out) = @{${$jobs}[$first++]};
+	    my $cmd = join (" ", map { qq{"$_"} } ($clang_delta, @{$args}));
+	    push @res, run_clang_delta ("$cmd > \"$out\"");
+	    next;
+	}
+	foreach my $s (@sent) {
+	    (my $server, my $id) = @{$s};
+	    my $fh = ${$server}[2];
+	    my $code;
+	    while (my $line = <$fh>) {
+		if ($line =~ /^(\S+) ([0-9]+)$/ && $1 eq $id) {
+		    $code = $2;
+		    last;
+		}
+	    }
+	    if (!defined $code) {
+		# the server is gone; run this one by itself
+		@servers = grep { $_ != $server } @servers;
+		(my $args, my $out) = @{${$jobs}[$first]};
+		my $cmd = join (" ", map { qq{"$_"} } ($clang_delta, @{$args}));
+		push @res, run_clang_delta ("$cmd > \"$out\"");
+	    } else {
+		push @res, clang_delta_result ($code);
+	    }
+	    $first++;
+	}
+    }
+    return @res;
+}
+
+sub clang_delta_limits () {
+    my $flags = "";
+    $flags .= " --max-errors=$CLANG_MAX_ERRORS" if defined $CLANG_MAX_ERRORS;
+    $flags .= " --max-instantiation-depth=$CLANG_MAX_DEPTH" if defined $CLANG_MAX_DEPTH;
+    $flags .= " --time-limit=$CLANG_TIME_LIMIT" if defined $CLANG_TIME_LIMIT;
+    return $flags;
+}
+
+# number of instances of each clang_delta transformation, keyed by the
+# MD5 of the file contents they were counted on and then by the name of
+# the transformation; the passes only ever look at the current best
+# file, so the driver drops all of it when it accepts a new one
+
+my %instance_counts;
+
+sub instances_key ($) {
+    (my $cfile) = @_;
+    return md5_hex(read_file($cfile));
+}
+
+sub cached_instances ($$) {
+    (my $key, my $which) = @_;
+    return undef unless defined $instance_counts{$key};
+    return $instance_counts{$key}{$which};
+}
+
+sub cache_instances ($$$) {
+    (my $key, my $which, my $n) = @_;
+    $instance_counts{$key}{$which} = $n;
+}
+
+sub forget_instances () {
+    %instance_counts = ();
+}
+
+# for handing the counts made by a transform that ran in a child
+# process (see --transform-budget) back to the driver
+sub export_instances () {
+    return \%instance_counts;
+}
+
+sub import_instances ($) {
+    (my $counts) = @_;
+    foreach my $key (keys %{$counts}) {
+	foreach my $which (keys %{${$counts}{$key}}) {
+	    $instance_counts{$key}{$which} = ${$counts}{$key}{$which};
+	}
+    }
+}
+
+# a transform may return, after its state, a description of the change
+# it made to the file, which the driver takes on trust instead of
+# comparing the whole variant with the best file: whether the file
+# changed at all, how many bytes it grew by (negative when it shrank)
+# and, if known, the range [start, end) of the original that was
+# replaced
+sub change_made ($$;$$) {
+    (my $changed, my $delta, my $start, my $end) = @_;
+    my %change = (
+	"changed" => $changed,
+	"delta"   => $delta,
+	"start"   => $start,
+	"end"     => $end,
+	);
+    return \%change;
+}
+
+# --focus: the function, or the line of the first file to reduce, that
+# the reduction centres on, e.g. where the compiler crashes; the passes
+# that support it try the candidates farthest from it first
+$FOCUS = undef;
+
+# a line number is turned into the text of that line, which is looked
+# for again in each variant, since the line moves as the lines above it
+# go away
+my $focus_file;
+my $focus_text;
+my $focus_lineno;
+
+sub focus_init ($) {
+    (my $cfile) = @_;
+    return unless defined $FOCUS;
+    (undef, undef, $focus_file) = File::Spec->splitpath($cfile);
+    return unless ($FOCUS =~ /^[0-9]+$/);
+    $focus_lineno = $FOCUS - 1;
+    my @lines = split /\n/, read_file($cfile);
+    die "--focus: '$cfile' has no line $FOCUS\n" unless ($focus_lineno < scalar(@lines));
+    ($focus_text = $lines[$focus_lineno]) =~ s/^\s+|\s+$//g;
+    die "--focus: line $FOCUS of '$cfile' is blank\n" if ($focus_text eq "");
+}
+
+# the index of the focus line in $prog, the contents of $cfile, or
+# undef if $cfile is not the file with the focus or the focus is gone
+sub focus_line ($$) {
+    (my $cfile, my $prog) = @_;
+    return undef unless defined $FOCUS;
+    (undef, undef, my $f) = File::Spec->splitpath($cfile);
+    return undef unless ($f eq $focus_file);
+    if (defined $focus_text) {
+	# topformflat may have joined the focus to the lines around it, so
+	# any line that contains it will do; a line like "}" may well be
+	# there more than once, so take the one closest to where the focus
+	# was in the original file
+	my @lines = split /\n/, $prog;
+	my $best;
+	for (my $i=0; $i<scalar(@lines); $i++) {
+	    next unless (index($lines[$i], $focus_text) >= 0);
+	    $best = $i if (!defined($best) ||
+			   abs($i - $focus_lineno) < abs($best - $focus_lineno));
+	}
+	return $best;
+    }
+    # the definition of the function if there is one, or else the
+    # first place it is named
+    my $pos;
+    if ($prog =~ /\b\Q$FOCUS\E\s*\([^;{}]*\)[^;{}()]*\{/) {
+	$pos = $-[0];
+    } elsif ($prog =~ /\b\Q$FOCUS\E\b/) {
+	$pos = $-[0];
+    } else {
+	return undef;
+    }
+    return (substr($prog, 0, $pos) =~ tr/\n//);
+}
+
 # utility code to help us replace the nth occurrence of a pattern
 $replace_cont = 0;
 $matched = 0;
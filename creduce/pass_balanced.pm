@@ -42,13 +42,116 @@ sub remove_outside ($) {
     return $str;
 }
 
+# the character that each kind of candidate starts with, for --focus
+my %opening = (
+    "square" => "[",
+    "angles" => "<",
+    "parens" => "(",
+    "curly"  => "{",
+    );
+
+sub opening ($) {
+    (my $arg) = @_;
+    return "=" if ($arg eq "curly3");
+    (my $kind = $arg) =~ s/[-0-9].*$//;
+    return $opening{$kind};
+}
+
 # this function is idiotically stupid and slow but I spent a long time
 # trying to get nested matches out of Perl's various utilities for
 # matching balanced delimiters, with no success
 
+# returns $rest with the candidate at its start changed, or undef for
+# an unexpected argument
+sub change_first ($$) {
+    (my $arg, my $rest2) = @_;
+    if (0) {
+    } elsif ($arg eq "square-inside") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'[]'}))/\[\]/s;
+    } elsif ($arg eq "angles-inside") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'<>'}))/\<\>/s;
+    } elsif ($arg eq "parens-inside") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))/\(\)/s;
+    } elsif ($arg eq "curly-inside") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))/\{\}/s;
+    } elsif ($arg eq "square") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'[]'}))//s;
+    } elsif ($arg eq "angles") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'<>'}))//s;
+    } elsif ($arg eq "parens-to-zero") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))/0/s;
+    } elsif ($arg eq "parens") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))//s;
+    } elsif ($arg eq "curly") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))//s;
+    } elsif ($arg eq "curly2") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))/;/s;
+    } elsif ($arg eq "curly3") {
+	$rest2 =~ s/^(?<all>(=\s*$RE{balanced}{-parens=>'{}'}))//s;
+    } elsif ($arg eq "parens-only") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))/remove_outside($+{all})/se;
+    } elsif ($arg eq "curly-only") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))/remove_outside($+{all})/se;
+    } elsif ($arg eq "angles-only") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'<>'}))/remove_outside($+{all})/se;
+    } elsif ($arg eq "square-only") {
+	$rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'[]'}))/remove_outside($+{all})/se;
+    } else {
+	return undef;
+    }
+    return $rest2;
+}
+
+# --focus: the offsets where a candidate may start, those on the lines
+# farthest from the focus first; the state counts the offsets tried,
+# and since they are found again for each variant, after a candidate
+# is deleted the same count lands on the next one
+sub focus_offsets ($$$) {
+    (my $cfile, my $prog, my $open) = @_;
+    my $f = focus_line ($cfile, $prog);
+    # without a focus in this file, go from the back to the front
+    $f = 0 unless defined($f);
+    my @offsets = ();
+    my $line = 0;
+    while ($prog =~ /(\n)|\Q$open\E/g) {
+	if (defined($1)) {
+	    $line++;
+	} else {
+	    push @offsets, [$-[0], abs($line - $f)];
+	}
+    }
+    return map { ${$_}[0] }
+	sort { ${$b}[1] <=> ${$a}[1] || ${$b}[0] <=> ${$a}[0] } @offsets;
+}
+
+sub transform_focus ($$$) {
+    (my $cfile, my $arg, my $state) = @_;
+
+    my $n = ${$state};
+    my $prog = read_file ($cfile);
+    my $open = opening ($arg);
+    return ($ERROR, "unexpected argument") unless defined($open);
+    my @offsets = focus_offsets ($cfile, $prog, $open);
+
+    while ($n < scalar(@offsets)) {
+	my $pos = $offsets[$n];
+	my $rest = substr ($prog, $pos);
+	my $rest2 = change_first ($arg, $rest);
+	if ($rest ne $rest2) {
+	    write_file ($cfile, substr ($prog, 0, $pos) . $rest2);
+	    return ($OK, \$n,
+		    change_made (1, length($rest2) - length($rest), $pos));
+	}
+	$n++;
+    }
+    return ($STOP, \$n);
+}
+
 sub transform ($$$) {
     (my $cfile, my $arg, my $state) = @_;
 
+    return transform_focus ($cfile, $arg, $state) if (defined($FOCUS));
+
     my $pos = ${$state};
     my $prog = read_file ($cfile);
 
@@ -56,45 +159,12 @@ sub transform ($$$) {
 
 	my $first = substr ($prog, 0, $pos);
 	my $rest = substr ($prog, $pos);
-	my $rest2 = $rest;
-
-	if (0) {
-	} elsif ($arg eq "square-inside") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'[]'}))/\[\]/s;
-	} elsif ($arg eq "angles-inside") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'<>'}))/\<\>/s;
-	} elsif ($arg eq "parens-inside") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))/\(\)/s;
-	} elsif ($arg eq "curly-inside") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))/\{\}/s;
-	} elsif ($arg eq "square") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'[]'}))//s;
-	} elsif ($arg eq "angles") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'<>'}))//s;
-	} elsif ($arg eq "parens-to-zero") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))/0/s;
-	} elsif ($arg eq "parens") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))//s;
-	} elsif ($arg eq "curly") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))//s;
-	} elsif ($arg eq "curly2") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))/;/s;
-	} elsif ($arg eq "curly3") {
-	    $rest2 =~ s/^(?<all>(=\s*$RE{balanced}{-parens=>'{}'}))//s;
-	} elsif ($arg eq "parens-only") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'()'}))/remove_outside($+{all})/se;
-	} elsif ($arg eq "curly-only") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'{}'}))/remove_outside($+{all})/se;
-	} elsif ($arg eq "angles-only") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'<>'}))/remove_outside($+{all})/se;
-	} elsif ($arg eq "square-only") {
-	    $rest2 =~ s/^(?<all>($RE{balanced}{-parens=>'[]'}))/remove_outside($+{all})/se;
-	} else {
-	    return ($ERROR, "unexpected argument");
-	}
+	my $rest2 = change_first ($arg, $rest);
+	return ($ERROR, "unexpected argument") unless defined($rest2);
 	if ($rest ne $rest2) {
 	    write_file ($cfile, $first . $rest2);
-	    return ($OK, \$pos);
+	    return ($OK, \$pos,
+		    change_made (1, length($rest2) - length($rest), $pos));
 	}
 	$pos++;
 	if ($pos > length($prog)) {
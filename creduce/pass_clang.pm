@@ -43,6 +43,7 @@ sub check_prereqs () {
     }
     if ((-e $path) && (-x $path)) {
 	$clang_delta = $path;
+	use_clang_delta ($path);
 	return 1;
     }
     # Check Windows
@@ -54,35 +55,237 @@ sub check_prereqs () {
     return 0;
 }
 
+sub prefetch ($$) {
+    (my $files, my $args) = @_;
+    my $list = join(",", @{$args});
+    foreach my $cfile (@{$files}) {
+        my $limits = clang_delta_limits();
+        my $cmd = qq{"$clang_delta"$limits --query-instances=$list $cfile};
+        print "$cmd\n" if $DEBUG;
+        my @out = `$cmd`;
+        # a crash in any transformation loses all of the counts, in
+        # which case the passes simply run without them
+        next unless ($? == 0);
+        my $key = instances_key($cfile);
+        foreach my $line (@out) {
+            if ($line =~ /^Available transformation instances of (\S+): (\d+)$/) {
+                cache_instances($key, $1, $2);
+            } elsif ($line =~ /^Available transformation instances: (\d+)$/) {
+                cache_instances($key, ${$args}[0], $1);
+            }
+        }
+    }
+}
+
+# outcomes of earlier variants, per transformation and per function
+# the variant changed: [successes, failures]
+my %history;
+
+# with $ORDER_BY_HISTORY, a candidate in a function where the
+# transformation has kept failing is put aside instead of being tested;
+# once the transformation runs out of candidates, the ones put aside
+# are either tried after all or, while the driver is not yet checking
+# for a fixpoint, skipped
+sub unpromising ($$) {
+    (my $which, my $feature) = @_;
+    my $h = $history{$which}{$feature};
+    return 0 unless defined $h;
+    (my $ok, my $failed) = @{$h};
+    return ($failed >= 4 && $ok * 8 < $failed);
+}
+
+# name of the function enclosing the first line that differs between
+# the two files, or "" if that line is outside of any function
+sub changed_function ($$) {
+    (my $before, my $after) = @_;
+    my @a = split /\n/, read_file($before);
+    my @b = split /\n/, read_file($after);
+    my $line = 0;
+    $line++ while ($line < @a && $line < @b && $a[$line] eq $b[$line]);
+    my $depth = 0;
+    my $candidate = "";
+    my $name = "";
+    for (my $i = 0; $i <= $line && $i < @a; $i++) {
+        my $l = $a[$i];
+        $candidate = $1 if ($depth == 0 && $l =~ /(\w+)\s*\(/);
+        foreach my $c ($l =~ /([{}])/g) {
+            if ($c eq "{") {
+                $name = $candidate if ($depth == 0);
+                $depth++;
+            } elsif ($depth > 0) {
+                $depth--;
+            }
+        }
+    }
+    return ($depth > 0) ? $name : "";
+}
+
+# with clang_delta servers, the variants for the candidates after the
+# one asked for are made along with it, one per server: [result, file]
+# by transformation and counter, all made from the file with this key
+my %made_ahead;
+my $made_ahead_key = "";
+my $made_ahead_pid;
+
+sub forget_made_ahead () {
+    foreach my $which (keys %made_ahead) {
+        unlink ${$_}[1] foreach (values %{$made_ahead{$which}});
+    }
+    %made_ahead = ();
+}
+
+END {
+    forget_made_ahead() if (defined $made_ahead_pid && $$ == $made_ahead_pid);
+}
+
+# a transform that ran in a child process (see --transform-budget)
+# hands back the variants it made ahead, and the driver takes over
+# their files
+sub export_state () {
+    return [$made_ahead_key, \%made_ahead];
+}
+
+sub import_state ($) {
+    (my $made) = @_;
+    ($made_ahead_key, my $ahead) = @{$made};
+    %made_ahead = %{$ahead};
+    $made_ahead_pid = $$ if (%made_ahead);
+}
+
+# makes the variant for candidate $index in $tmpfile, unless it was
+# made ahead of time, and returns what run_clang_delta would; with
+# $ahead, also makes those for the candidates after it
+sub make_variant ($$$$$$$) {
+    (my $cfile, my $key, my $which, my $index, my $count, my $tmpfile,
+     my $ahead) = @_;
+    if ($key ne $made_ahead_key) {
+        forget_made_ahead();
+        $made_ahead_key = $key;
+    }
+    my $made = delete $made_ahead{$which}{$index};
+    if (defined $made) {
+        print "$which: candidate $index was made ahead of time\n" if $DEBUG;
+        File::Copy::move(${$made}[1], $tmpfile);
+        return ${$made}[0];
+    }
+    my @limits = split (' ', clang_delta_limits());
+    my $n = $ahead ? clang_delta_servers() : 1;
+    $n = 1 if ($n < 1);
+    my @jobs = ();
+    for (my $i = $index; $i < $index + $n; $i++) {
+        last if (defined $count && $i > $count);
+        my $out = clang_delta_output();
+        push @jobs, [[@limits, "--transformation=$which", "--counter=$i", $cfile], $out];
+    }
+    my @res = run_clang_delta_batch ($clang_delta, \@jobs);
+    File::Copy::move(${$jobs[0]}[1], $tmpfile);
+    $made_ahead_pid = $$ if (@jobs > 1);
+    for (my $i = 1; $i < @jobs; $i++) {
+        $made_ahead{$which}{$index + $i} = [$res[$i], ${$jobs[$i]}[1]];
+    }
+    return $res[0];
+}
+
 sub new ($$) {
-    my $index = 1;
-    return \$index;
+    my %state = (
+        "index"    => 1,
+        "deferred" => [],
+        "pos"      => -1,
+        "tried"    => 0,
+        "feature"  => undef,
+        );
+    return \%state;
 }
 
 sub advance ($$$) {
     (my $cfile, my $arg, my $state) = @_;
-    my $index = ${$state};
-    $index++;
-    return \$index;
+    my %state = %{$state};
+    if ($state{"pos"} < 0) {
+        $state{"index"}++;
+    } else {
+        $state{"pos"}++;
+    }
+    $state{"tried"} = 0;
+    $state{"feature"} = undef;
+    return \%state;
+}
+
+sub feedback ($$$) {
+    (my $which, my $state, my $success) = @_;
+    my $feature = ${$state}{"feature"};
+    return unless defined $feature;
+    $history{$which}{$feature} = [0, 0] unless defined $history{$which}{$feature};
+    ${$history{$which}{$feature}}[$success ? 0 : 1]++;
 }
 
 sub transform ($$$) {
     (my $cfile, my $which, my $state) = @_;
-    my $index = ${$state};
-    my $tmpfile = File::Temp::tmpnam();
-    my $cmd = qq{"$clang_delta" --transformation=$which --counter=$index $cfile};
-    print "$cmd\n" if $DEBUG;
-    my $res = run_clang_delta ("$cmd > $tmpfile");
-    if ($res==0) {
-	File::Copy::move($tmpfile, $cfile);
-	return ($OK, \$index);
-    } else {
-        unlink $tmpfile;
-	if (($res != -1) && ($res != -2)) {
-	    return ($ERROR, "crashed: $cmd");
+    my %state = %{$state};
+    my @deferred = @{$state{"deferred"}};
+    if ($state{"tried"} && $state{"pos"} >= 0) {
+        # the candidate put aside at this position was accepted and
+        # is gone, so the ones after it have moved down by one
+        splice (@deferred, $state{"pos"}, 1);
+        $_-- foreach (@deferred[$state{"pos"}..$#deferred]);
+    }
+    $state{"deferred"} = \@deferred;
+    $state{"tried"} = 1;
+    my $key = instances_key($cfile);
+    my $count = cached_instances($key, $which);
+
+    while (1) {
+        my $index;
+        if ($state{"pos"} < 0) {
+            $index = $state{"index"};
+        } else {
+            return ($STOP, \%state) if ($state{"pos"} >= @deferred);
+            $index = $deferred[$state{"pos"}];
+        }
+        my $res;
+        my $tmpfile = File::Temp::tmpnam();
+        my $limits = clang_delta_limits();
+        my $cmd = qq{"$clang_delta"$limits --transformation=$which --counter=$index $cfile};
+        if (defined $count && $index > $count) {
+            print "$which: only $count instances\n" if $DEBUG;
+            $res = -2;
+        } else {
+            print "$cmd\n" if $DEBUG;
+            $res = make_variant ($cfile, $key, $which, $index, $count, $tmpfile,
+                                 $state{"pos"} < 0);
+            # an invalid counter means we have run out of instances
+            if ($res == -2 && !defined $count) {
+                $count = $index - 1;
+                cache_instances($key, $which, $count);
+            }
+        }
+        if ($res==0) {
+            my $feature;
+            $feature = changed_function ($cfile, $tmpfile) if $ORDER_BY_HISTORY;
+            if (defined $feature && $state{"pos"} < 0 &&
+                unpromising ($which, $feature)) {
+                print "$which: putting aside candidate $index in '$feature'\n"
+                    if $DEBUG;
+                unlink $tmpfile;
+                push @deferred, $index;
+                $state{"index"}++;
+                next;
+            }
+            File::Copy::move($tmpfile, $cfile);
+            $state{"feature"} = $feature;
+            return ($OK, \%state);
         } else {
-	    return ($STOP, \$index);
-	}
+            unlink $tmpfile;
+            if (($res != -1) && ($res != -2) && ($res != -4)) {
+                return ($ERROR, "crashed: $cmd");
+            }
+            # out of candidates; go back to the ones put aside, if any
+            return ($STOP, \%state) if ($state{"pos"} >= 0 || !@deferred);
+            if ($ORDER_BY_HISTORY == 1) {
+                $PUT_ASIDE += @deferred;
+                return ($STOP, \%state);
+            }
+            $state{"pos"} = 0;
+        }
     }
 }
 
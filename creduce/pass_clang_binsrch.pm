@@ -30,13 +30,17 @@ my $ORIG_DIR;
 
 sub count_instances ($$) {
     (my $cfile, my $which) = @_;
-    open INF, qq{"$clang_delta" --query-instances=$which $cfile |} or die;
+    my $key = instances_key($cfile);
+    my $n = cached_instances($key, $which);
+    return $n if defined $n;
+    my $limits = clang_delta_limits();
+    open INF, qq{"$clang_delta"$limits --query-instances=$which $cfile |} or die;
     my $line = <INF>;
-    my $n = 0;
+    $n = 0;
     if ($line =~ /Available transformation instances: ([0-9]+)$/) {
       $n = $1;
     }
-    close INF;
+    cache_instances($key, $which, $n) if (close INF);
     return $n;
 }
 
@@ -55,6 +59,7 @@ sub check_prereqs () {
     }
     if ((-e $path) && (-x $path)) {
 	$clang_delta = $path;
+	use_clang_delta ($path);
 	return 1;
     }
     # Check Windows
@@ -122,9 +127,12 @@ sub transform ($$$) {
 
 	my $dec = $end - $index + 1;
 
-	my $cmd = qq{"$clang_delta" --transformation=$which --counter=$index --to-counter=$end $cfile};
+	my $limits = clang_delta_limits();
+	my @args = (split (' ', $limits), "--transformation=$which",
+		    "--counter=$index", "--to-counter=$end", $cfile);
+	my $cmd = qq{"$clang_delta"$limits --transformation=$which --counter=$index --to-counter=$end $cfile};
 	print "$cmd\n" if $DEBUG;
-	my $res = run_clang_delta ("$cmd > $tmpfile");
+	(my $res) = run_clang_delta_batch ($clang_delta, [[\@args, $tmpfile]]);
 
 	if ($res==0) {
 	    File::Copy::move($tmpfile, $cfile);
@@ -136,6 +144,10 @@ sub transform ($$$) {
 		unlink $tmpfile;
 		print "out of instances!\n" if $DEBUG;
 		goto rechunk;
+	    } elsif ($res == -4) {
+		unlink $tmpfile;
+		print "clang_delta gave up\n" if $DEBUG;
+		return ($STOP, \%sh);
 	    } else {
 		unlink $tmpfile;
 		return ($ERROR, "crashed: $cmd");
@@ -70,10 +70,21 @@ sub transform ($$$) {
     (my $cfile, my $which, my $state) = @_;
     my $index = ${$state};
     my $tmpfile = File::Temp::tmpnam();
-    my $cmd = qq{"$clex" $which $index $cfile};
+    my $rules = defined $TOKENIZER ? qq{"--tokenizer=$TOKENIZER" } : "";
+    my $errfile;
+    if ($BALANCED_TOKENS && $which =~ /^rm-tok/) {
+	# clex skips unbalanced windows itself and says where it ended up
+	$rules .= "--balanced ";
+	$errfile = File::Temp::tmpnam();
+    }
+    my $cmd = qq{"$clex" ${rules}$which $index $cfile};
     print "$cmd\n" if $DEBUG;
-    system ("$cmd > $tmpfile");
+    system ("$cmd > $tmpfile" . (defined $errfile ? " 2> $errfile" : ""));
     my $res = $? >> 8;
+    if (defined $errfile) {
+	$index = $1 if ($res == 51 && read_file($errfile) =~ /^index (\d+)$/m);
+	unlink $errfile;
+    }
     if ($res == 51) {
 	File::Copy::move($tmpfile, $cfile);
 	return ($OK, \$index);
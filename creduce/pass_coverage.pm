@@ -0,0 +1,230 @@
+## -*- mode: Perl -*-
+##
+## Copyright (c) 2019 The University of Utah
+## All rights reserved.
+##
+## This file is distributed under the University of Illinois Open Source
+## License.  See the file COPYING for details.
+
+###############################################################################
+
+package pass_coverage;
+
+use strict;
+use warnings;
+
+use POSIX;
+
+use Cwd 'abs_path';
+use Digest::MD5 qw(md5_hex);
+use File::Basename;
+use File::Copy;
+use File::Spec;
+use File::Temp;
+
+use creduce_config qw(bindir libexecdir);
+use creduce_utils;
+
+# Deletes the code that the program does not execute, for reductions
+# whose interestingness test runs it.  Each new best file is compiled
+# once with $COVERAGE_CC --coverage and run, and gcov's line counts are
+# handed to clang_delta's remove-unexecuted-code, whose instances are
+# the function bodies, branches and statements that never ran.  All of
+# them go in the first variant; if that one is not interesting they are
+# tried in halves, quarters and so on down to one at a time, as in
+# delta debugging.
+#
+# A run that crashes or does not finish within $RUN_TIMEOUT seconds
+# writes no counts, and then the pass has nothing to do.
+
+my $RUN_TIMEOUT = 10;
+
+my $which = "remove-unexecuted-code";
+
+# `$clang_delta' is initialized by `check_prereqs()'.
+my $clang_delta = "clang_delta";
+
+# where the instrumented builds go, one directory for each file
+# contents (named by its MD5); the directories double as the cache of
+# gcov files, which also works for transforms that run in a child
+# process (see --transform-budget)
+my $workdir;
+
+sub check_prereqs () {
+    $workdir = File::Temp::tempdir("coverage-XXXXXX", CLEANUP => 1,
+				   DIR => File::Spec->tmpdir)
+	if (defined $COVERAGE_CC && !defined $workdir);
+    my $path;
+    my $abs_bindir = abs_path(bindir);
+    if ((defined $abs_bindir) && ($FindBin::RealBin eq $abs_bindir)) {
+	# This script is in the installation directory.
+	# Use the installed `clang_delta'.
+	$path = libexecdir . "/clang_delta";
+    } else {
+	# Assume that this script is in the C-Reduce build tree.
+	# Use the `clang_delta' that is also in the build tree.
+	$path = "$FindBin::Bin/../clang_delta/clang_delta";
+    }
+    if ((-e $path) && (-x $path)) {
+	$clang_delta = $path;
+	return 1;
+    }
+    # Check Windows
+    $path=$path . ".exe";
+    if (($^O eq "MSWin32") && (-e $path) && (-x $path)) {
+	$clang_delta = $path;
+	return 1;
+    }
+    return 0;
+}
+
+# the gcov that reads what the compiler writes: gcc-9 goes with gcov-9
+# and clang-9 with llvm-cov-9
+sub gcov_command () {
+    (my $cc) = split ' ', $COVERAGE_CC;
+    my $base = basename($cc);
+    my $tool = "gcov";
+    if ($base =~ /clang/) {
+	($tool = $base) =~ s/clang(\+\+)?/llvm-cov/;
+	$tool .= " gcov";
+    } elsif ($base =~ /g(cc|\+\+)/) {
+	($tool = $base) =~ s/g(cc|\+\+)/gcov/;
+    }
+    $tool = File::Spec->catfile(dirname($cc), $tool) if ($cc =~ /\//);
+    return $tool;
+}
+
+# run the program in $dir, killing it after $RUN_TIMEOUT seconds
+sub run_program ($) {
+    (my $dir) = @_;
+    my $pid = fork();
+    die "fork failed" unless defined $pid;
+    if ($pid == 0) {
+	chdir $dir or POSIX::_exit(127);
+	open STDIN, "</dev/null";
+	open STDOUT, ">/dev/null";
+	open STDERR, ">/dev/null";
+	exec("./cov") or POSIX::_exit(127);
+    }
+    eval {
+	local $SIG{ALRM} = sub { die "TIMEOUT\n"; };
+	alarm($RUN_TIMEOUT);
+	waitpid($pid, 0);
+	alarm(0);
+    };
+    if ($@) {
+	kill ('KILL', $pid);
+	waitpid($pid, 0);
+    }
+}
+
+# the gcov file for the current contents of $cfile, or undef
+sub coverage ($) {
+    (my $cfile) = @_;
+    my $key = md5_hex(read_file($cfile));
+    my $dir = File::Spec->catdir($workdir, $key);
+    (my $suffix) = ($cfile =~ /(\.[^.\/]+)$/);
+    $suffix = ".c" unless defined $suffix;
+    my $gcov_file = "$dir/cov$suffix.gcov";
+    if (! -d $dir) {
+	# built elsewhere and then renamed, so that a build cut short
+	# leaves nothing behind under $dir
+	my $build = File::Temp::tempdir(DIR => $workdir);
+	File::Copy::copy($cfile, "$build/cov$suffix") or die;
+
+	my $quiet = $DEBUG ? "" : " > /dev/null 2>&1";
+	my $gcov = gcov_command();
+	if (runit ("cd $build && $COVERAGE_CC --coverage -c -o cov.o cov$suffix$quiet") == 0 &&
+	    runit ("cd $build && $COVERAGE_CC --coverage -o cov cov.o$quiet") == 0) {
+	    run_program($build);
+	    unlink "$build/cov$suffix.gcov"
+		unless (-e "$build/cov.gcda" &&
+			runit ("cd $build && $gcov -o . cov$suffix$quiet") == 0);
+	}
+	rename $build, $dir or die;
+	print "coverage of $cfile: ", ((-e $gcov_file) ? $gcov_file : "none"),
+	    "\n" if $DEBUG;
+    }
+    return (-e $gcov_file) ? $gcov_file : undef;
+}
+
+sub count_instances ($$) {
+    (my $cfile, my $gcov) = @_;
+    my $key = instances_key($cfile);
+    my $n = cached_instances($key, $which);
+    return $n if defined $n;
+    my $limits = clang_delta_limits();
+    open INF, qq{"$clang_delta"$limits --query-instances=$which --coverage=$gcov $cfile |} or die;
+    my $line = <INF>;
+    $n = 0;
+    if ($line =~ /Available transformation instances: ([0-9]+)$/) {
+      $n = $1;
+    }
+    cache_instances($key, $which, $n) if (close INF);
+    return $n;
+}
+
+sub new ($$) {
+    (my $cfile, my $arg) = @_;
+    my %sh;
+    $sh{"start"} = 1;
+    return \%sh;
+}
+
+sub advance ($$$) {
+    (my $cfile, my $arg, my $state) = @_;
+    my %sh = %{$state};
+    return \%sh if defined($sh{"start"});
+    $sh{"index"} += $sh{"chunk"};
+    return \%sh;
+}
+
+sub transform ($$$) {
+    (my $cfile, my $arg, my $state) = @_;
+    my %sh = %{$state};
+
+    return ($STOP, \%sh) unless defined $COVERAGE_CC;
+    my $gcov = coverage($cfile);
+    return ($STOP, \%sh) unless defined $gcov;
+    my $instances = count_instances($cfile, $gcov);
+    return ($STOP, \%sh) if ($instances == 0);
+
+    if (defined($sh{"start"})) {
+	delete $sh{"start"};
+	$sh{"chunk"} = $instances;
+	$sh{"index"} = 1;
+    }
+  AGAIN:
+    while ($sh{"index"} > $instances) {
+	return ($STOP, \%sh) if ($sh{"chunk"} == 1);
+	$sh{"chunk"} = int (($sh{"chunk"} + 1) / 2);
+	$sh{"index"} = 1;
+    }
+
+    my $index = $sh{"index"};
+    my $end = $index + $sh{"chunk"} - 1;
+    $end = $instances if ($end > $instances);
+    print "TRANSFORM: index = $index, end = $end, instances = $instances\n"
+	if $DEBUG;
+
+    my $tmpfile = File::Temp::tmpnam();
+    my $limits = clang_delta_limits();
+    my $cmd = qq{"$clang_delta"$limits --transformation=$which --coverage=$gcov --counter=$index --to-counter=$end $cfile};
+    print "$cmd\n" if $DEBUG;
+    my $res = run_clang_delta ("$cmd > $tmpfile");
+
+    if ($res == 0) {
+	File::Copy::move($tmpfile, $cfile);
+	return ($OK, \%sh);
+    }
+    unlink $tmpfile;
+    if ($res == -2) {
+	# fewer instances than counted; try the next granularity
+	$sh{"index"} = $instances + 1;
+	goto AGAIN;
+    }
+    return ($STOP, \%sh) if ($res == -1 || $res == -4);
+    return ($ERROR, "crashed: $cmd");
+}
+
+1;
@@ -0,0 +1,140 @@
+## -*- mode: Perl -*-
+##
+## Copyright (c) 2019 The University of Utah
+## All rights reserved.
+##
+## This file is distributed under the University of Illinois Open Source
+## License.  See the file COPYING for details.
+
+###############################################################################
+
+package pass_dedup;
+
+use strict;
+use warnings;
+
+use Digest::MD5 qw(md5);
+
+use creduce_utils;
+
+# Removes top-level forms that repeat an earlier one, up to whitespace
+# and comments: extern prototypes, typedefs and inline functions that
+# came in through several include paths.  All of the repeats go in the
+# first variant; after that they are tried in halves, quarters and so
+# on, like the chunks of pass_lines.
+
+sub check_prereqs () {
+    return 1;
+}
+
+# split a file into top-level forms, the way topformflat does: a form
+# ends with a semicolon or closing brace outside of any braces,
+# parentheses or brackets, or, for preprocessor directives, at the end
+# of the line; whatever whitespace follows a form belongs to it
+sub top_level_forms ($) {
+    (my $prog) = @_;
+    my @forms = ();
+    my $depth = 0;
+    my $start = 0;
+    my $bol = 1;
+    pos($prog) = 0;
+    while (pos($prog) < length($prog)) {
+        if ($bol && $depth == 0 && $prog =~ /\G[ \t]*#(?:[^\n\\]|\\.)*\n?/sgc) {
+            # a directive is a form of its own
+        } elsif ($prog =~ /\G(?:"(?:[^"\\\n]|\\.)*"|'(?:[^'\\\n]|\\.)*'|\/\*.*?\*\/|\/\/[^\n]*)/sgc) {
+            $bol = 0;
+            next;
+        } elsif ($prog =~ /\G\n/gc) {
+            $bol = 1;
+            next;
+        } elsif ($prog =~ /\G([{(\[])/gc) {
+            $depth++;
+            $bol = 0;
+            next;
+        } elsif ($prog =~ /\G([})\]])/gc) {
+            $depth-- if ($depth > 0);
+            $bol = 0;
+            next unless ($depth == 0 && $1 eq "}");
+            # "struct s { ... } x;" is one form
+            next if ($prog =~ /\G(?=[ \t]*(?:\w|;))/gc);
+        } elsif ($prog =~ /\G;/gc) {
+            $bol = 0;
+            next unless ($depth == 0);
+        } else {
+            $prog =~ /\G(?:[ \t]+|[^\s"'\/{}()\[\];]+|.)/sgc;
+            $bol = 0 unless (substr($prog, pos($prog) - 1, 1) =~ /[ \t]/);
+            next;
+        }
+        $prog =~ /\G\s*/gc;
+        $bol = 1;
+        push @forms, substr($prog, $start, pos($prog) - $start);
+        $start = pos($prog);
+    }
+    push @forms, substr($prog, $start) if ($start < length($prog));
+    return @forms;
+}
+
+sub normalize ($) {
+    (my $form) = @_;
+    my @toks = ($form =~ /("(?:[^"\\]|\\.)*"|'(?:[^'\\]|\\.)*'|\/\*.*?\*\/|\/\/[^\n]*|\w+|\S)/sg);
+    return join (" ", grep { !/^\/[\/*]/ } @toks);
+}
+
+# indices of the forms that repeat an earlier one; forms with nothing
+# but whitespace and comments in them don't count, and neither do
+# preprocessor directives, whose meaning depends on where they are
+sub duplicates (@) {
+    my %seen = ();
+    my @dups = ();
+    for (my $i = 0; $i < @_; $i++) {
+        my $n = normalize($_[$i]);
+        next if ($n eq "" || $n =~ /^#/);
+        my $key = md5($n);
+        if ($seen{$key}) {
+            push @dups, $i;
+        } else {
+            $seen{$key} = 1;
+        }
+    }
+    return @dups;
+}
+
+sub new ($$) {
+    my %state = (
+        "chunk" => undef,
+        "index" => 0,
+        );
+    return \%state;
+}
+
+sub advance ($$$) {
+    (my $cfile, my $arg, my $state) = @_;
+    my %state = %{$state};
+    $state{"index"} += $state{"chunk"};
+    return \%state;
+}
+
+sub transform ($$$) {
+    (my $cfile, my $arg, my $state) = @_;
+    my %state = %{$state};
+
+    my @forms = top_level_forms(read_file($cfile));
+    my @dups = duplicates(@forms);
+    return ($STOP, \%state) unless @dups;
+    $state{"chunk"} = scalar(@dups) unless defined $state{"chunk"};
+    if ($state{"index"} >= scalar(@dups)) {
+        return ($STOP, \%state) if ($state{"chunk"} == 1);
+        $state{"chunk"} = int(($state{"chunk"} + 1) / 2);
+        $state{"index"} = 0;
+    }
+
+    my $last = $state{"index"} + $state{"chunk"} - 1;
+    $last = $#dups if ($last > $#dups);
+    foreach my $i (@dups[$state{"index"}..$last]) {
+        $forms[$i] = "";
+    }
+    write_file($cfile, join("", @forms));
+    return ($OK, \%state);
+}
+
+1;
@@ -0,0 +1,84 @@
+## -*- mode: Perl -*-
+##
+## Copyright (c) 2019 The University of Utah
+## All rights reserved.
+##
+## This file is distributed under the University of Illinois Open Source
+## License.  See the file COPYING for details.
+
+###############################################################################
+
+package pass_flags;
+
+use strict;
+use warnings;
+
+use creduce_utils;
+
+# Reduces the compiler flags in the file given with --flags-file, which
+# is the only file this pass sees.  A flag that takes its value as a
+# separate word, like "-D FOO" or "-Xclang -ast-dump", is deleted along
+# with it.  All of the flags go in the first variant; after that they
+# are tried in halves, quarters and so on, like the chunks of
+# pass_lines, so expensive ones like -g, -flto and the sanitizers tend
+# to go early and make every later test cheaper.
+
+# flags whose value is the next word
+my %takes_value = map { $_ => 1 } qw(
+    -D -U -I -L -o -x -MF -MT -MQ -include -imacros -isystem -iquote
+    -idirafter -isysroot --sysroot -target -arch -Xclang -Xlinker
+    -Xassembler -Xpreprocessor -mllvm
+    );
+
+sub check_prereqs () {
+    return 1;
+}
+
+# the flags in the file, each with the value that goes with it; words
+# are split the way a shell would, keeping quoted strings whole
+sub flags ($) {
+    (my $text) = @_;
+    my @words = ($text =~ /((?:"(?:[^"\\]|\\.)*"|'[^']*'|\\.|[^\s"'\\])+)/sg);
+    my @flags = ();
+    while (@words) {
+        my $w = shift @words;
+        $w .= " " . shift @words if ($takes_value{$w} && @words);
+        push @flags, $w;
+    }
+    return @flags;
+}
+
+sub new ($$) {
+    my %state = (
+        "chunk" => undef,
+        "index" => 0,
+        );
+    return \%state;
+}
+
+sub advance ($$$) {
+    (my $cfile, my $arg, my $state) = @_;
+    my %state = %{$state};
+    $state{"index"} += $state{"chunk"};
+    return \%state;
+}
+
+sub transform ($$$) {
+    (my $cfile, my $arg, my $state) = @_;
+    my %state = %{$state};
+
+    my @flags = flags(read_file($cfile));
+    return ($STOP, \%state) unless @flags;
+    $state{"chunk"} = scalar(@flags) unless defined $state{"chunk"};
+    if ($state{"index"} >= scalar(@flags)) {
+        return ($STOP, \%state) if ($state{"chunk"} == 1);
+        $state{"chunk"} = int(($state{"chunk"} + 1) / 2);
+        $state{"index"} = 0;
+    }
+
+    splice @flags, $state{"index"}, $state{"chunk"};
+    write_file($cfile, @flags ? join(" ", @flags) . "\n" : "");
+    return ($OK, \%state);
+}
+
+1;
@@ -178,8 +178,10 @@ sub transform ($$$) {
         goto AGAIN;
     }
 
+    # the compare above has shown that the file changed
+    my $change = change_made (1, (-s $tmpfile) - (-s $cfile));
     File::Copy::move($tmpfile, $cfile);
-    return ($OK, \%sh);
+    return ($OK, \%sh, $change);
 }
 
 1;
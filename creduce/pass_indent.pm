@@ -13,6 +13,8 @@ package pass_indent;
 use strict;
 use warnings;
 
+use File::Basename;
+
 use creduce_config qw(CLANG_FORMAT);
 use creduce_utils;
 
@@ -47,20 +49,106 @@ sub invoke_clang_format ($$) {
 
 my $spaces = "-style='{SpacesInAngles: true}'";
 
+# what each file looked like right after this pass last looked at it,
+# keyed by file name and sub-pass; the driver always hands us a copy of
+# the current best file, so only the lines that differ from this need
+# formatting again
+my %last;
+
+# for handing %last back to the driver when the transform ran in a
+# child process (see --transform-budget)
+sub export_state () {
+    return \%last;
+}
+
+sub import_state ($) {
+    (my $last) = @_;
+    %last = %{$last};
+}
+
+# more ranges than this and we just format the whole file
+my $MAX_RANGES = 100;
+
+sub tokens ($) {
+    (my $text) = @_;
+    return join (" ", ($text =~ /(\w+|\S)/g));
+}
+
+# line ranges (1-based, inclusive) of $new that are not simply carried
+# over from $old; a deletion marks the line that now follows it, since
+# the lines around a deletion may have to be joined or re-indented
+sub changed_ranges ($$) {
+    (my $old, my $new) = @_;
+    my @a = split /\n/, $old, -1;
+    my @b = split /\n/, $new, -1;
+    my %pos;
+    for (my $i = 0; $i < @a; $i++) {
+        push @{$pos{$a[$i]}}, $i;
+    }
+    # $i only moves forward, so each line's position list is searched
+    # from where its last search stopped
+    my %cursor;
+    my @changed = ();
+    my $i = 0;
+    for (my $j = 0; $j < @b; $j++) {
+        if ($i < @a && $a[$i] eq $b[$j]) {
+            $i++;
+            next;
+        }
+        # resynchronize on the next occurrence of this line in the old
+        # text, if any, treating everything skipped over as deleted
+        my $p = $pos{$b[$j]};
+        if (defined $p) {
+            my $c = $cursor{$b[$j]} || 0;
+            $c++ while ($c < @{$p} && ${$p}[$c] <= $i);
+            $cursor{$b[$j]} = $c;
+            $i = ${$p}[$c] + 1 if ($c < @{$p});
+        }
+        push @changed, $j + 1;
+    }
+    push @changed, scalar(@b) if ($i < @a && @b);
+    my @ranges = ();
+    foreach my $l (@changed) {
+        if (@ranges && $l <= ${$ranges[-1]}[1] + 1) {
+            ${$ranges[-1]}[1] = $l if ($l > ${$ranges[-1]}[1]);
+        } else {
+            push @ranges, [$l, $l];
+        }
+    }
+    return @ranges;
+}
+
 sub transform ($$$) {
     (my $cfile, my $arg, my $state) = @_;
     my $index = ${$state};
     my $old = read_file($cfile);
+    (my $name) = File::Basename::fileparse($cfile);
+    my $key = "$arg $name";
   AGAIN:
     return ($STOP, \$index) unless ($index == 0);
     if ($arg eq "regular") {
-	invoke_clang_format($cfile, $spaces);
+        my $lines = "";
+        if (defined $last{$key}) {
+            # if only the whitespace changed since last time, any
+            # formatting there was already tried
+            if (tokens($old) eq tokens($last{$key})) {
+                $last{$key} = $old;
+                $index++;
+                goto AGAIN;
+            }
+            my @ranges = changed_ranges ($last{$key}, $old);
+            if (scalar(@ranges) <= $MAX_RANGES) {
+                $lines = join ("", map { " --lines=${$_}[0]:${$_}[1]" } @ranges);
+            }
+        }
+	invoke_clang_format($cfile, "$spaces$lines");
     } elsif ($arg eq "final") {
         invoke_clang_format($cfile, "");
     } else {
         die;
     }
     my $new = read_file($cfile);
+    $last{$key} = $new;
     if ($old eq $new) {
 	$index++;
 	goto AGAIN;
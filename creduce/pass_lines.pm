@@ -49,7 +49,8 @@ sub check_prereqs () {
 }
 
 # unlike the previous version of pass_lines, this one always
-# progresses from the back of the file to the front
+# progresses from the back of the file to the front, except with
+# --focus, where it starts from the lines farthest from the focus
 
 sub new ($$) {
     (my $cfile, my $arg) = @_;
@@ -62,6 +63,10 @@ sub advance ($$$) {
     (my $cfile, my $which, my $state) = @_;
     my %sh = %{$state};
     die if (defined($sh{"start"}));
+    if (defined($sh{"focus"})) {
+	$sh{"nth"}++;
+	return \%sh;
+    }
     my $pos = $sh{"index"};
     $sh{"index"} -= $sh{"chunk"};
     my $i = $sh{"index"};
@@ -113,9 +118,15 @@ sub transform ($$$) {
 	my $l = scalar(@data);
 	$sh{"index"} = $l;
 	$sh{"chunk"} = $l;
+	if (defined($FOCUS)) {
+	    $sh{"focus"} = 1;
+	    $sh{"nth"} = 0;
+	}
 	return ($OK, \%sh);
     }
 
+    return transform_focus ($cfile, \%sh) if (defined($sh{"focus"}));
+
     if ($DEBUG) {
 	my $c = $sh{"chunk"};
 	my $i = $sh{"index"};
@@ -139,23 +150,26 @@ sub transform ($$$) {
 	my $start = $sh{"index"} - $sh{"chunk"};
 	$start = 0 if ($start < 0);
 	my $lines = scalar(@data);
-	splice @data, $start, $sh{"chunk"};
+	my @gone = splice @data, $start, $sh{"chunk"};
 	my $newlines = scalar(@data);
 	my $c = $sh{"chunk"};
 	print "went from $lines lines to $newlines with chunk $c\n" if $DEBUG;
+	# none of the lines is empty, so the file changed if any are gone
+	if (!@gone) {
+	    print "did not change file\n" if $DEBUG;
+	    $sh{"index"} -= $sh{"chunk"};
+	    goto AGAIN;
+	}
 	my $tmpfile = File::Temp::tmpnam();
 	open OUTF, ">$tmpfile" or die;
 	foreach my $line (@data) {
 	    print OUTF $line;
 	}
 	close OUTF;
-	if (compare($cfile, $tmpfile) == 0) {
-	    print "did not change file\n" if $DEBUG;
-	    unlink $tmpfile;
-	    $sh{"index"} -= $sh{"chunk"};
-	    goto AGAIN;
-	}
 	File::Copy::move($tmpfile, $cfile);
+	my $from = length (join ("", @data[0 .. $start - 1]));
+	my $len = length (join ("", @gone));
+	return ($OK, \%sh, change_made (1, -$len, $from, $from + $len));
     } else {
 	return ($STOP, \%sh) if ($sh{"chunk"} <= 1);
 	my $newchunk = int ($sh{"chunk"} / 2.0);
@@ -164,8 +178,58 @@ sub transform ($$$) {
 	$sh{"index"} = scalar(@data);
 	goto AGAIN;
     }
+}
 
-    return ($OK, \%sh);
+# the chunks of $n lines at the current granularity, laid out from line
+# $f both ways, with the distance from $f to their nearest line; the
+# chunks are tried farthest first, those after $f before those before it
+sub focus_chunks ($$$) {
+    (my $n, my $f, my $chunk) = @_;
+    my @chunks = ();
+    for (my $start = $f; $start < $n; $start += $chunk) {
+	push @chunks, [$start, $chunk, $start - $f];
+    }
+    for (my $end = $f; $end > 0; $end -= $chunk) {
+	my $start = $end - $chunk;
+	$start = 0 if ($start < 0);
+	push @chunks, [$start, $end - $start, $f - $end + 1];
+    }
+    return sort { ${$b}[2] <=> ${$a}[2] || ${$b}[0] <=> ${$a}[0] } @chunks;
+}
+
+# the state counts the chunks tried at this granularity; they are laid
+# out again for each variant, so after a chunk is deleted the same
+# count lands on the next one
+sub transform_focus ($$) {
+    (my $cfile, my $state) = @_;
+    my %sh = %{$state};
+
+    my $prog = read_file ($cfile);
+    my @data = split /^/, $prog;
+    # without a focus in this file, e.g. in another file than the one
+    # with the focus, the back of the file is the farthest from line 0
+    my $f = focus_line ($cfile, $prog);
+    $f = 0 unless defined($f);
+
+  AGAIN:
+    my @chunks = focus_chunks (scalar(@data), $f, $sh{"chunk"});
+    if ($sh{"nth"} < scalar(@chunks)) {
+	(my $start, my $len) = @{$chunks[$sh{"nth"}]};
+	my @rest = @data;
+	my @gone = splice @rest, $start, $len;
+	print "deleting $len lines at $start, focus at $f\n" if $DEBUG;
+	write_file ($cfile, join ("", @rest));
+	my $from = length (join ("", @rest[0 .. $start - 1]));
+	my $bytes = length (join ("", @gone));
+	return ($OK, \%sh, change_made (1, -$bytes, $from, $from + $bytes));
+    } else {
+	return ($STOP, \%sh) if ($sh{"chunk"} <= 1);
+	my $newchunk = int ($sh{"chunk"} / 2.0);
+	$sh{"chunk"} = $newchunk;
+	print "granularity reduced to $newchunk\n" if $DEBUG;
+	$sh{"nth"} = 0;
+	goto AGAIN;
+    }
 }
 
 1;
@@ -81,8 +81,9 @@ sub transform ($$$) {
 	if (compare($cfile, $tmpfile) == 0) {
 	    goto AGAIN;
         }
+	my $change = change_made (1, (-s $tmpfile) - (-s $cfile));
 	File::Copy::move($tmpfile, $cfile);
-	return ($OK, \$index);
+	return ($OK, \$index, $change);
     }
 
   AGAIN:
@@ -100,8 +101,9 @@ sub transform ($$$) {
 	print "AGAIN!\n" if $DEBUG;
 	goto AGAIN;
     }
+    my $change = change_made (1, (-s $tmpfile) - (-s $cfile));
     File::Copy::move($tmpfile, $cfile);
-    return ($OK, \$index);
+    return ($OK, \$index, $change);
 }
 
 1;
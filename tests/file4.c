@@ -0,0 +1,12 @@
+int a1;
+int a2;
+int a3;
+int a4;
+int f(void) {
+  int x = 1;
+  return x + 41;
+}
+int b1;
+int b2;
+int b3;
+int b4;
@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+##
+## Copyright (c) 2019 The University of Utah
+## All rights reserved.
+##
+## This file is distributed under the University of Illinois Open Source
+## License.  See the file COPYING for details.
+
+###############################################################################
+
+# run with --focus 7, the line with the return statement, which
+# topformflat joins to the rest of f; as long as the focus is found
+# there, the lines before f go first and those right after it stay
+
+file="file4.c"
+
+if [ $# -ne 0 ]; then
+  echo "usage: $0" 1>&2
+  exit 1
+fi
+
+if
+  grep -q 'return x + 41;' "$file" &&\
+  [ "$(grep -c . "$file")" -ge 5 ]
+then
+  exit 0
+else
+  exit 1
+fi